@@ -49,6 +49,8 @@ target_link_libraries(clap-wrapper-compile-options INTERFACE clap-wrapper-compil
 add_library(clap-wrapper-sanitizer-options INTERFACE)
 
 target_compile_options(clap-wrapper-compile-options-public INTERFACE -D${CLAP_WRAPPER_PLATFORM}=1 -DCLAP_WRAPPER_VERSION="${CLAP_WRAPPER_VERSION}")
+target_compile_options(clap-wrapper-compile-options INTERFACE -DCLAP_WRAPPER_PROCESS_TIMING=$<IF:$<BOOL:${CLAP_WRAPPER_PROCESS_TIMING}>,1,0>)
+target_compile_options(clap-wrapper-compile-options INTERFACE -DCLAP_WRAPPER_AUDIT_REALTIME=$<IF:$<BOOL:${CLAP_WRAPPER_AUDIT_REALTIME}>,1,0>)
 if (APPLE)
     target_link_libraries(clap-wrapper-compile-options-public INTERFACE macos_filesystem_support)
 endif()
@@ -165,11 +167,19 @@ function(guarantee_clap_wrapper_shared)
             src/clap_proxy.cpp
             src/detail/shared/sha1.h
             src/detail/shared/sha1.cpp
+            src/detail/shared/threadpool.h
+            src/detail/shared/threadpool.cpp
+            src/detail/shared/logring.h
+            src/detail/shared/logring.cpp
             src/detail/clap/fsutil.h
             src/detail/clap/fsutil.cpp
             src/detail/clap/automation.h
             )
     target_link_libraries(clap-wrapper-shared-detail PUBLIC clap clap-wrapper-extensions clap-wrapper-compile-options-public)
+
+    # the thread pool behind the clap thread pool host extension
+    find_package(Threads REQUIRED)
+    target_link_libraries(clap-wrapper-shared-detail PUBLIC Threads::Threads)
     target_link_libraries(clap-wrapper-shared-detail PRIVATE clap-wrapper-compile-options)
 
     if (TARGET fmt-header-only)
@@ -187,6 +197,23 @@ function(guarantee_clap_wrapper_shared)
                 )
         target_link_libraries(clap-wrapper-shared-detail PRIVATE macos_filesystem_support)
     endif()
+
+    if (CLAP_WRAPPER_AUDIT_REALTIME)
+        message(STATUS "clap-wrapper: auditing allocations and locks on the audio thread")
+        target_sources(clap-wrapper-shared-detail PRIVATE
+                src/detail/shared/realtimeaudit.h
+                src/detail/shared/realtimeaudit.cpp
+                )
+        target_link_libraries(clap-wrapper-shared-detail PUBLIC ${CMAKE_DL_LIBS})
+
+        if (UNIX AND NOT APPLE)
+            # LD_PRELOAD this into the host to see the allocations and locks of plugins loaded
+            # with dlopen(RTLD_LOCAL), see realtimeaudit.h
+            add_library(clap-wrapper-realtime-audit SHARED src/detail/shared/realtimeaudit_preload.cpp)
+            target_include_directories(clap-wrapper-realtime-audit PRIVATE src)
+            target_link_libraries(clap-wrapper-realtime-audit PRIVATE clap-wrapper-compile-options ${CMAKE_DL_LIBS})
+        endif()
+    endif()
 endfunction(guarantee_clap_wrapper_shared)
 
 # add a SetFile POST_BUILD for bundles if you aren't using xcode
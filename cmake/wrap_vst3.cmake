@@ -20,6 +20,12 @@ function(private_add_vst3_wrapper_sources)
             ${sd}/src/detail/ara/ara.h
             ${sd}/src/detail/vst3/parameter.h
             ${sd}/src/detail/vst3/parameter.cpp
+            ${sd}/src/detail/vst3/parametertable.h
+            ${sd}/src/detail/vst3/parametertable.cpp
+            ${sd}/src/detail/vst3/parameterlayout.h
+            ${sd}/src/detail/vst3/parameterlayout.cpp
+            ${sd}/src/detail/vst3/midiproxies.h
+            ${sd}/src/detail/vst3/midiproxies.cpp
             ${sd}/src/detail/vst3/plugview.h
             ${sd}/src/detail/vst3/plugview.cpp
             ${sd}/src/detail/vst3/state.h
@@ -96,6 +102,9 @@ function(target_add_vst3_wrapper)
 
         target_compile_options(${V3_TARGET}-clap-wrapper-vst3-lib PRIVATE
                 -DCLAP_SUPPORTS_ALL_NOTE_EXPRESSIONS=$<IF:$<BOOL:${V3_SUPPORTS_ALL_NOTE_EXPRESSIONS}>,1,0>
+                -DCLAP_WRAPPER_DETECT_CONSTANT_BUFFERS=$<IF:$<BOOL:${CLAP_WRAPPER_DETECT_CONSTANT_BUFFERS}>,1,0>
+                -DCLAP_WRAPPER_VST3_COMPRESS_STATE=$<IF:$<BOOL:${CLAP_WRAPPER_VST3_COMPRESS_STATE}>,1,0>
+                -DCLAP_WRAPPER_VST3_CACHE_STATE=$<IF:$<BOOL:${CLAP_WRAPPER_VST3_CACHE_STATE}>,1,0>
                 )
     endif()
 
@@ -1,5 +1,6 @@
 #include "clap_proxy.h"
 #include "detail/clap/fsutil.h"
+#include "detail/shared/logring.h"
 #include <cstring>
 
 #if MAC || LIN
@@ -110,6 +111,9 @@ const clap_host_posix_fd_support hostposixfd = {
 const clap_host_latency latency = {[](const clap_host_t* host) -> void
                                    { self(host)->latency_changed(); }};
 
+const clap_host_thread_pool_t threadpool = {[](const clap_host_t* host, uint32_t num_tasks) -> bool
+                                            { return self(host)->request_exec(num_tasks); }};
+
 const clap_host_state_t state = {[](const clap_host_t* host) -> void { self(host)->mark_dirty(); }};
 
 const clap_host_context_menu_t context_menu = {
@@ -182,6 +186,12 @@ Plugin::Plugin(IHost* host)
           Plugin::clapRequestCallback}
   , _parentHost(host)
 {
+  // plugins are created on the main thread, which keeps its tag for good
+  if (ClapWrapper::detail::shared::threadRole() == ClapWrapper::detail::shared::ThreadRole::unknown)
+  {
+    ClapWrapper::detail::shared::setThreadRole(ClapWrapper::detail::shared::ThreadRole::main);
+  }
+  ClapWrapper::detail::shared::log::startWriter();
 }
 
 template <typename T>
@@ -213,6 +223,11 @@ void Plugin::connectClap(const clap_plugin_t* clap)
   getExtension(_plugin, _ext._gui, CLAP_EXT_GUI);
   getExtension(_plugin, _ext._timer, CLAP_EXT_TIMER_SUPPORT);
   getExtension(_plugin, _ext._ara, CLAP_EXT_ARA_PLUGINEXTENSION);
+  getExtension(_plugin, _ext._threadpool, CLAP_EXT_THREAD_POOL);
+  if (_ext._threadpool)
+  {
+    _threadPool = ClapWrapper::detail::shared::ThreadPool::acquire();
+  }
 
   getExtension(_plugin, _ext._contextmenu, CLAP_EXT_CONTEXT_MENU);
   if (_ext._contextmenu == nullptr)
@@ -252,6 +267,7 @@ Plugin::~Plugin()
     _plugin->destroy(_plugin);
     _plugin = nullptr;
   }
+  ClapWrapper::detail::shared::log::stopWriter();
 }
 
 void Plugin::schnick()
@@ -328,19 +344,19 @@ void Plugin::deactivate() const
 
 bool Plugin::start_processing()
 {
-  auto thisFn = AlwaysAudioThread();
+  ClapWrapper::detail::shared::AudioThreadEntry audioThread;
   return _plugin->start_processing(_plugin);
 }
 
 void Plugin::stop_processing()
 {
-  auto thisFn = AlwaysAudioThread();
+  ClapWrapper::detail::shared::AudioThreadEntry audioThread;
   _plugin->stop_processing(_plugin);
 }
 
 void Plugin::reset()
 {
-  auto thisFn = AlwaysAudioThread();
+  ClapWrapper::detail::shared::AudioThreadEntry audioThread;
   _plugin->reset(_plugin);
 }
 
@@ -407,74 +423,58 @@ bool Plugin::context_menu_popup(const clap_context_menu_target_t* target, int32_
 
 void Plugin::log(clap_log_severity severity, const char* msg)
 {
-  std::string n;
-  switch (severity)
-  {
-    case CLAP_LOG_DEBUG:
-      n.append("PLUGIN: DEBUG: ");
-      break;
-    case CLAP_LOG_INFO:
-      n.append("PLUGIN: INFO: ");
-      break;
-    case CLAP_LOG_WARNING:
-      n.append("PLUGIN: WARNING: ");
-      break;
-    case CLAP_LOG_ERROR:
-      n.append("PLUGIN: ERROR: ");
-      break;
-    case CLAP_LOG_FATAL:
-      n.append("PLUGIN: FATAL: ");
-      break;
-    case CLAP_LOG_PLUGIN_MISBEHAVING:
-      n.append("PLUGIN: MISBEHAVING: ");
-      break;
-    case CLAP_LOG_HOST_MISBEHAVING:
-      n.append("PLUGIN: HOST MISBEHAVING: ");
+  // this may be called from the audio thread, the message is only copied into the log ring
+  ClapWrapper::detail::shared::log::post(ClapWrapper::detail::shared::log::Source::plugin, severity,
+                                         msg, strlen(msg));
 #if WIN
-      OutputDebugStringA(msg);
-      _CrtDbgBreak();
-#endif
-#if MAC
-      fprintf(stderr, "%s\n", msg);
-#endif
-      break;
+  if (severity == CLAP_LOG_HOST_MISBEHAVING)
+  {
+    // the message has to be visible when the debugger stops, the break halts this thread
+    // anyway so it doesn't matter that flushing locks, even on the audio thread
+    ClapWrapper::detail::shared::log::flush();
+    _CrtDbgBreak();
   }
-  n.append(msg);
-#if WIN
-  OutputDebugStringA(n.c_str());
-  OutputDebugStringA("\n");
-#endif
-#if MAC
-  fprintf(stderr, "%s\n", n.c_str());
 #endif
 }
 
 bool Plugin::is_main_thread() const
 {
-  if (this->_main_thread_override > 0)
-  {
-    return true;
-  }
-  return _main_thread_id == std::this_thread::get_id();
+  return ClapWrapper::detail::shared::threadRole() == ClapWrapper::detail::shared::ThreadRole::main;
 }
 
 bool Plugin::is_audio_thread() const
 {
-  if (this->_audio_thread_override > 0)
+  return ClapWrapper::detail::shared::threadRole() == ClapWrapper::detail::shared::ThreadRole::audio;
+}
+
+// Schedules num_tasks calls of clap_plugin_thread_pool::exec() on the wrapper's thread pool
+// and blocks until all of them returned.
+// [audio-thread]
+bool Plugin::request_exec(uint32_t num_tasks)
+{
+  // the pool rejects calls from its own workers, anything else outside of the audio
+  // thread isn't inside process()
+  if (!_threadPool || !is_audio_thread())
   {
-    return true;
+    return false;
   }
-  return !(_main_thread_id == std::this_thread::get_id());
+  return _threadPool->run(
+      [](void* context, uint32_t index)
+      {
+        auto self = static_cast<Plugin*>(context);
+        self->_ext._threadpool->exec(self->_plugin, index);
+      },
+      this, num_tasks);
 }
 
 CLAP_NODISCARD Raise Plugin::AlwaysAudioThread()
 {
-  return Raise(this->_audio_thread_override);
+  return Raise(ClapWrapper::detail::shared::ThreadRole::audio);
 }
 
 CLAP_NODISCARD Raise Plugin::AlwaysMainThread()
 {
-  return Raise(this->_main_thread_override);
+  return Raise(ClapWrapper::detail::shared::ThreadRole::main);
 }
 
 void Plugin::param_rescan(clap_param_rescan_flags flags)
@@ -509,6 +509,7 @@ const void* Plugin::clapExtension(const clap_host* /*host*/, const char* extensi
     return &HostExt::tail;
   }
   if (!strcmp(extension, CLAP_EXT_STATE)) return &HostExt::state;
+  if (!strcmp(extension, CLAP_EXT_THREAD_POOL)) return &HostExt::threadpool;
   if (!strcmp(extension, CLAP_EXT_CONTEXT_MENU)) return &HostExt::context_menu;
 
   return nullptr;
@@ -536,8 +537,9 @@ void Plugin::clapRequestRestart(const clap_host* host)
 // [thread-safe]
 void Plugin::clapRequestProcess(const clap_host* host)
 {
-  // right now, I don't know how to communicate this to the host
-  // in VST3 you can't force processing...
+  // in VST3 you can't force processing, but the wrapper can stop skipping a sleeping plugin
+  auto self = static_cast<Plugin*>(host->host_data);
+  self->_parentHost->request_process();
 }
 
 // Registers a periodic timer.
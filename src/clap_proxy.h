@@ -25,6 +25,8 @@
 #endif
 
 #include "detail/clap/fsutil.h"
+#include "detail/shared/threadpool.h"
+#include "detail/shared/threadrole.h"
 
 namespace Clap
 {
@@ -71,6 +73,11 @@ class IHost
 
   virtual const char* host_get_name() = 0;
 
+  // [thread-safe] the plugin wants to be processed again, e.g. to wake up from sleep
+  virtual void request_process()
+  {
+  }
+
   // context menu
 
   // actually, everything here should be virtual only, but until all wrappers are updated,
@@ -113,25 +120,22 @@ struct ClapPluginExtensions
   const clap_plugin_timer_support_t* _timer = nullptr;
   const clap_plugin_context_menu_t* _contextmenu = nullptr;
   const clap_ara_plugin_extension_t* _ara = nullptr;
+  const clap_plugin_thread_pool_t* _threadpool = nullptr;
 #if LIN
   const clap_plugin_posix_fd_support* _posixfd = nullptr;
 #endif
 };
 
+// makes the calling thread count as main or audio thread while it exists
 class Raise
 {
  public:
-  Raise(std::atomic<uint32_t>& counter) : ctx(counter)
+  explicit Raise(ClapWrapper::detail::shared::ThreadRole role) : _scope(role)
   {
-    ++ctx;
-  }
-  ~Raise()
-  {
-    ctx--;
   }
 
  private:
-  std::atomic<uint32_t>& ctx;
+  ClapWrapper::detail::shared::ThreadRoleScope _scope;
 };
 
 /// <summary>
@@ -190,6 +194,9 @@ class Plugin
   bool is_main_thread() const;
   bool is_audio_thread() const;
 
+  // thread pool
+  bool request_exec(uint32_t num_tasks);
+
   // param
   void param_rescan(clap_param_rescan_flags flags);
   void param_clear(clap_id param, clap_param_clear_flags flags);
@@ -256,9 +263,9 @@ class Plugin
 
   clap_host_t _host;  // the host_t structure for the proxy
   IHost* _parentHost = nullptr;
-  const std::thread::id _main_thread_id = std::this_thread::get_id();
-  std::atomic<uint32_t> _audio_thread_override = 0;
-  std::atomic<uint32_t> _main_thread_override = 0;
+
+  // only held if the plugin implements the thread pool extension
+  std::shared_ptr<ClapWrapper::detail::shared::ThreadPool> _threadPool;
 
   AudioSetup _audioSetup;
 };
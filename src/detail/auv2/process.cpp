@@ -141,16 +141,28 @@ void ProcessAdapter::setupProcessing(ausdk::AUScope& audioInputs, ausdk::AUScope
   _out_events.ctx = this;
   _out_events.try_push = output_events_try_push;
 
-  _events.clear();
-  _events.reserve(8192);
-  _eventindices.clear();
-  _eventindices.reserve(_events.capacity());
+  // room for a few automation points of every parameter and a dense stream of MIDI events
+  auto numEvents = std::max<size_t>(8192, (_parameters ? _parameters->size() * 4 : 0) + numMaxSamples);
+  _events.reserve(numEvents, numEvents * sizeof(clap_event_param_value_t));
+  // the arena holds more than numEvents, there is headroom for events ending notes
+  _eventSorter.reserve(_events.capacity());
 
   _out_events.ctx = this;
 
-  _gesturedParameters.reserve(8192);
+  // dense parameter indices for the audio thread
+  std::vector<clap_id> ids;
+  if (_parameters)
+  {
+    ids.reserve(_parameters->size());
+    for (auto& p : *_parameters)
+    {
+      ids.push_back(p.first);
+    }
+  }
+  _parameterIndex.build(ids);
+  _gesturedParameters.resize(_parameterIndex.size());
 
-  _activeNotes.reserve(32);
+  _activeNotes.clear();
 }
 
 void ProcessAdapter::sortEventIndices()
@@ -159,15 +171,10 @@ void ProcessAdapter::sortEventIndices()
   // an item must be sorted to front of
   // if the timestamp if event[a] is earlier than
   // the timestamp of event[b].
-  // if they have the same timestamp, the index must be preserved
-
-  std::sort(_eventindices.begin(), _eventindices.end(),
-            [&](size_t const& a, size_t const& b)
-            {
-              auto t1 = _events[a].header.time;
-              auto t2 = _events[b].header.time;
-              return (t1 == t2) ? (a < b) : (t1 < t2);
-            });
+  // if they have the same timestamp, the index must be preserved.
+  // the events are added in ascending runs, so these are merged rather than sorted.
+
+  _eventSorter.sort(_events.order(), [this](uint32_t offset) { return _events.at(offset)->time; });
 }
 
 void ProcessAdapter::process(ProcessData& data)
@@ -275,7 +282,6 @@ void ProcessAdapter::process(ProcessData& data)
 
   // clean up and prepare the events for the next cycle
   _events.clear();
-  _eventindices.clear();
 }
 
 uint32_t ProcessAdapter::input_events_size(const struct clap_input_events* list)
@@ -287,19 +293,12 @@ uint32_t ProcessAdapter::input_events_size(const struct clap_input_events* list)
 }
 
 // returns the pointer to an event in the list. The index accessed is not the position in the event list itself
-// since all events indices were sorted by timestamp
+// since the event order was sorted by timestamp
 const clap_event_header_t* ProcessAdapter::input_events_get(const struct clap_input_events* list,
                                                             uint32_t index)
 {
   auto self = static_cast<ProcessAdapter*>(list->ctx);
-  if (self->_events.size() > index)
-  {
-    // we can safely return the note.header also for other event types
-    // since they are at the same memory address
-    auto realindex = self->_eventindices[index];
-    return &(self->_events[realindex].header);
-  }
-  return nullptr;
+  return self->_events.get(index);
 }
 
 bool ProcessAdapter::output_events_try_push(const struct clap_output_events* list,
@@ -389,10 +388,8 @@ bool ProcessAdapter::enqueueOutputEvent(const clap_event_header_t* event)
     case CLAP_EVENT_PARAM_GESTURE_BEGIN:
     {
       auto ev = (clap_event_param_gesture*)event;
-      auto param = _parameters->find(ev->param_id);
-      if (param != _parameters->end())
+      if (_gesturedParameters.begin(_parameterIndex.find(ev->param_id)))
       {
-        _gesturedParameters.push_back(ev->param_id);
         _automation->onBeginEdit(ev->param_id);
       }
     }
@@ -402,10 +399,8 @@ bool ProcessAdapter::enqueueOutputEvent(const clap_event_header_t* event)
     case CLAP_EVENT_PARAM_GESTURE_END:
     {
       auto ev = (clap_event_param_gesture*)event;
-      auto n = std::remove(_gesturedParameters.begin(), _gesturedParameters.end(), ev->param_id);
-      if (n != _gesturedParameters.end())
+      if (_gesturedParameters.end(_parameterIndex.find(ev->param_id)))
       {
-        _gesturedParameters.erase(n, _gesturedParameters.end());
         _automation->onEndEdit(ev->param_id);
       }
     }
@@ -424,31 +419,13 @@ bool ProcessAdapter::enqueueOutputEvent(const clap_event_header_t* event)
 
 void ProcessAdapter::addToActiveNotes(const clap_event_note* note)
 {
-  for (auto& i : _activeNotes)
-  {
-    if (!i.used)
-    {
-      i.note_id = note->note_id;
-      i.port_index = note->port_index;
-      i.channel = note->channel;
-      i.key = note->key;
-      i.used = true;
-      return;
-    }
-  }
-  _activeNotes.emplace_back(ActiveNote{true, note->note_id, note->port_index, note->channel, note->key});
+  // if the table is full, the note is counted as overflow and per-note events for it are dropped
+  _activeNotes.add(note->note_id, note->port_index, note->channel, note->key);
 }
 
 void ProcessAdapter::removeFromActiveNotes(const clap_event_note* note)
 {
-  for (auto& i : _activeNotes)
-  {
-    if (i.used && i.port_index == note->port_index && i.channel == note->channel &&
-        i.note_id == note->note_id)
-    {
-      i.used = false;
-    }
-  }
+  _activeNotes.remove(note->note_id, note->port_index, note->channel, note->key);
 }
 
 void ProcessAdapter::processOutputEvents()
@@ -508,9 +485,11 @@ void ProcessAdapter::addMIDIEvent(UInt32 inStatus, UInt32 inData1, UInt32 inData
         n.midi.data[1] = inData1;
         n.midi.data[2] = inData2;
       }
-      this->_eventindices.emplace_back((this->_events.size()));
-      this->_events.emplace_back(n);
-      removeFromActiveNotes(&n.note);
+      this->_events.push(&n.header);
+      if (n.header.type == CLAP_EVENT_NOTE_OFF)
+      {
+        removeFromActiveNotes(&n.note);
+      }
       this->output_events_try_push(&this->_out_events, &n.header);
       break;
     case 9:  // note on
@@ -537,9 +516,10 @@ void ProcessAdapter::addMIDIEvent(UInt32 inStatus, UInt32 inData1, UInt32 inData
         n.midi.data[2] = inData2;
       }
 
-      this->_eventindices.emplace_back((this->_events.size()));
-      this->_events.emplace_back(n);
-      addToActiveNotes(&n.note);
+      if (this->_events.push(&n.header) && n.header.type == CLAP_EVENT_NOTE_ON)
+      {
+        addToActiveNotes(&n.note);
+      }
 
       this->output_events_try_push(&this->_out_events, &n.header);
 
@@ -557,8 +537,7 @@ void ProcessAdapter::addMIDIEvent(UInt32 inStatus, UInt32 inData1, UInt32 inData
       n.midi.data[1] = inData1;
       n.midi.data[2] = inData2;
 
-      this->_eventindices.emplace_back((this->_events.size()));
-      this->_events.emplace_back(n);
+      this->_events.push(&n.header);
       break;
     case 0xF:
       break;
@@ -583,7 +562,6 @@ void ProcessAdapter::addParameterEvent(const clap_param_info_t& info, double val
   n.param.channel = -1;
   n.param.note_id = -1;
 
-  this->_eventindices.emplace_back(this->_events.size());
-  this->_events.emplace_back(n);
+  this->_events.push(&n.header);
 }
 }  // namespace Clap::AUv2
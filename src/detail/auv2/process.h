@@ -29,6 +29,10 @@
 #include <AudioToolbox/AudioUnitUtilities.h>
 #include <AudioUnit/AUComponent.h>
 #include "../clap/automation.h"
+#include "../shared/eventsort.h"
+#include "../shared/eventarena.h"
+#include "../shared/paramindex.h"
+#include "../shared/activenotes.h"
 #include "parameter.h"
 #include <map>
 
@@ -126,19 +130,14 @@ class ProcessAdapter
   const clap_plugin_t* _plugin = nullptr;
   const clap_plugin_params_t* _ext_params = nullptr;
 
+  // dense parameter index, built in setupProcessing()
+  ClapWrapper::detail::shared::ParamIndexMap _parameterIndex;
+
   // for automation gestures
-  std::vector<clap_id> _gesturedParameters;
+  ClapWrapper::detail::shared::GestureTracker _gesturedParameters;
 
   // for INoteExpression
-  struct ActiveNote
-  {
-    bool used = false;
-    int32_t note_id;  // -1 if unspecified, otherwise >=0
-    int16_t port_index;
-    int16_t channel;  // 0..15
-    int16_t key;      // 0..127
-  };
-  std::vector<ActiveNote> _activeNotes;
+  ClapWrapper::detail::shared::ActiveNoteTable _activeNotes;
 
   uint32_t _numInputs = 0;
   uint32_t _numOutputs = 0;
@@ -154,8 +153,9 @@ class ProcessAdapter
 
   clap_process_t _processData = {-1, 0, &_transport, nullptr, nullptr, 0, 0, &_in_events, &_out_events};
 
-  std::vector<clap_multi_event_t> _events;
-  std::vector<size_t> _eventindices;
+  // input events packed by size, in the order given to the plugin
+  ClapWrapper::detail::shared::EventArena _events;
+  ClapWrapper::detail::shared::EventIndexSorter _eventSorter;
 
   std::vector<clap_multi_event_t> _outevents;
 
@@ -10,6 +10,11 @@ class IAutomation
   virtual void onBeginEdit(clap_id id) = 0;
   virtual void onPerformEdit(const clap_event_param_value_t* value) = 0;
   virtual void onEndEdit(clap_id id) = 0;
+  // every parameter value the plugin outputs, inside a gesture or not. [audio-thread] or
+  // wherever the plugin is flushed, must not block.
+  virtual void onParameterOutput(clap_id /*id*/)
+  {
+  }
   virtual ~IAutomation()
   {
   }
@@ -5,17 +5,51 @@
     - global timer object
     - dispatch to UI thread
     - get binary name
+
+    There is no module wide message loop on Linux, the host hands out IRunLoop objects instead.
+    The helper collects them and registers a single idle timer with one of them, which calls
+    onIdle() of every attached instance. The instances run their CLAP timers from onIdle(), so
+    the idle timer runs at the shortest timer period any of them reports (but at least every
+    idleInterval). Run loop timers are periodic, the timer is only registered again when that
+    period changes, i.e. when timers are registered or unregistered.
+
+    Nothing is called before the host hands out a run loop, the same as for the editor.
 */
 
 #include "public.sdk/source/main/moduleinit.h"
+#include "base/source/fobject.h"
+#include <pluginterfaces/gui/iplugview.h>
 #include "osutil.h"
+#include <algorithm>
 #include <filesystem>
+#include <functional>
+#include <vector>
 #include <stdio.h>
+#include <time.h>
 
 #include <dlfcn.h>
 
 namespace os
 {
+class RunLoopTimer : public Steinberg::Linux::ITimerHandler, public Steinberg::FObject
+{
+ public:
+  explicit RunLoopTimer(std::function<void()> fn) : _fn(std::move(fn))
+  {
+  }
+  void PLUGIN_API onTimer() final
+  {
+    _fn();
+  }
+  DELEGATE_REFCOUNT(Steinberg::FObject)
+  DEFINE_INTERFACES
+  DEF_INTERFACE(Steinberg::Linux::ITimerHandler)
+  END_DEFINE_INTERFACES(Steinberg::FObject)
+
+ private:
+  std::function<void()> _fn;
+};
+
 class LinuxHelper
 {
  public:
@@ -24,9 +58,26 @@ class LinuxHelper
   void attach(IPlugObject* plugobject);
   void detach(IPlugObject* plugobject);
 
+  void addRunLoop(Steinberg::Linux::IRunLoop* runloop);
+  void removeRunLoop(Steinberg::Linux::IRunLoop* runloop);
+
  private:
+  static constexpr uint32_t idleInterval = 30;
+
   void executeDefered();
-  std::vector<IPlugObject*> _plugs;
+  // the shortest timer period of the attached instances, in [1, idleInterval]
+  uint32_t idlePeriod() const;
+  void armIdleTimer(uint32_t period_ms);
+  void connect(Steinberg::Linux::IRunLoop* runloop);
+  void disconnect();
+
+  // an instance can be attached more than once (while active and while its editor is open)
+  std::vector<std::pair<IPlugObject*, uint32_t>> _plugs;
+
+  std::vector<std::pair<Steinberg::Linux::IRunLoop*, uint32_t>> _runLoops;
+  Steinberg::Linux::IRunLoop* _runLoop = nullptr;  // the one the timers are registered with
+  Steinberg::IPtr<Steinberg::Linux::ITimerHandler> _idleTimer;
+  uint32_t _idlePeriod = 0;  // the period _idleTimer is registered with, 0 if it isn't
 } gLinuxHelper;
 
 #if 0
@@ -155,23 +206,154 @@ void LinuxHelper::init()
 
 void LinuxHelper::terminate()
 {
+  // all instances are gone, the run loops they handed out must not be called anymore
+  _runLoop = nullptr;
+  _idleTimer.reset();
+  _idlePeriod = 0;
+  _runLoops.clear();
+  _plugs.clear();
 }
 
 void LinuxHelper::executeDefered()
 {
-  for (auto p : _plugs)
+  // instances may detach while being called, so the list is copied and rechecked
+  auto plugs = _plugs;
+  for (auto& p : plugs)
   {
-    if (p) p->onIdle();
+    auto attached = std::find_if(_plugs.begin(), _plugs.end(),
+                                 [&p](const auto& a) { return a.first == p.first; });
+    if (attached != _plugs.end())
+    {
+      p.first->onIdle();
+    }
+  }
+
+  // an onIdle() may have removed the run loop
+  if (_runLoop)
+  {
+    armIdleTimer(idlePeriod());
   }
 }
+
+uint32_t LinuxHelper::idlePeriod() const
+{
+  uint32_t period = idleInterval;
+  for (auto& p : _plugs)
+  {
+    auto t = p.first->timerPeriod();
+    if (t > 0)
+    {
+      period = std::min(period, t);
+    }
+  }
+  return period;
+}
+
+void LinuxHelper::armIdleTimer(uint32_t period_ms)
+{
+  if (period_ms == _idlePeriod)
+  {
+    return;
+  }
+  // run loop timers are periodic, a different period needs a new registration
+  if (_idlePeriod > 0)
+  {
+    _runLoop->unregisterTimer(_idleTimer.get());
+  }
+  _runLoop->registerTimer(_idleTimer.get(), period_ms);
+  _idlePeriod = period_ms;
+}
+
 void LinuxHelper::attach(IPlugObject* plugobject)
 {
-  _plugs.push_back(plugobject);
+  for (auto& p : _plugs)
+  {
+    if (p.first == plugobject)
+    {
+      ++p.second;
+      return;
+    }
+  }
+  _plugs.emplace_back(plugobject, 1);
 }
 
 void LinuxHelper::detach(IPlugObject* plugobject)
 {
-  _plugs.erase(std::remove(_plugs.begin(), _plugs.end(), plugobject), _plugs.end());
+  for (auto it = _plugs.begin(); it != _plugs.end(); ++it)
+  {
+    if (it->first == plugobject)
+    {
+      if (--it->second == 0)
+      {
+        _plugs.erase(it);
+      }
+      return;
+    }
+  }
+}
+
+void LinuxHelper::addRunLoop(Steinberg::Linux::IRunLoop* runloop)
+{
+  if (!runloop)
+  {
+    return;
+  }
+  for (auto& r : _runLoops)
+  {
+    if (r.first == runloop)
+    {
+      ++r.second;
+      return;
+    }
+  }
+  _runLoops.emplace_back(runloop, 1);
+  if (!_runLoop)
+  {
+    connect(runloop);
+  }
+}
+
+void LinuxHelper::removeRunLoop(Steinberg::Linux::IRunLoop* runloop)
+{
+  auto it = std::find_if(_runLoops.begin(), _runLoops.end(),
+                         [runloop](const auto& r) { return r.first == runloop; });
+  if (it == _runLoops.end() || --it->second > 0)
+  {
+    return;
+  }
+  _runLoops.erase(it);
+  if (runloop == _runLoop)
+  {
+    disconnect();
+    if (!_runLoops.empty())
+    {
+      connect(_runLoops.front().first);
+    }
+  }
+}
+
+void LinuxHelper::connect(Steinberg::Linux::IRunLoop* runloop)
+{
+  _runLoop = runloop;
+  if (!_idleTimer)
+  {
+    _idleTimer = Steinberg::owned(new RunLoopTimer([this] { executeDefered(); }));
+  }
+  armIdleTimer(idlePeriod());
+}
+
+void LinuxHelper::disconnect()
+{
+  if (!_runLoop)
+  {
+    return;
+  }
+  if (_idlePeriod > 0)
+  {
+    _runLoop->unregisterTimer(_idleTimer.get());
+    _idlePeriod = 0;
+  }
+  _runLoop = nullptr;
 }
 
 }  // namespace os
@@ -190,8 +372,27 @@ void detach(IPlugObject* plugobject)
   gLinuxHelper.detach(plugobject);
 }
 
+// [UI Thread]
+void addRunLoop(Steinberg::Linux::IRunLoop* runloop)
+{
+  gLinuxHelper.addRunLoop(runloop);
+}
+
+// [UI Thread]
+void removeRunLoop(Steinberg::Linux::IRunLoop* runloop)
+{
+  gLinuxHelper.removeRunLoop(runloop);
+}
+
+uint64_t getTickInNS()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
 uint64_t getTickInMS()
 {
-  return clock();
+  return getTickInNS() / 1000000ull;
 }
 }  // namespace os
@@ -18,43 +18,55 @@
 
 #else
 
-#if WIN
-#include <windows.h>
-#endif
-#include <stdio.h>
+#include <algorithm>
+#include <cstring>
+#include "detail/shared/logring.h"
 
 namespace os
 {
 
+// messages are formatted into a buffer on the stack and printed by the log writer thread
+// (detail/shared/logring.h), so this doesn't allocate and can be used on the audio thread
+
+inline void log(clap_log_severity severity, const char* text, size_t length)
+{
+  ClapWrapper::detail::shared::log::post(ClapWrapper::detail::shared::log::Source::wrapper, severity,
+                                         text, length);
+}
+
 inline void log(const char* text)
 {
-#if WIN
-  OutputDebugStringA(text);
-  OutputDebugStringA("\n");
-#else
-  fprintf(stdout, "%s\n", text);
-  fflush(stdout);
-#endif
+  log(CLAP_LOG_INFO, text, strlen(text));
 }
 
 template <typename... Args>
 void log(fmt::string_view format_str, Args&&... args)
 {
-  fmt::memory_buffer buf;
-  fmt::vformat_to(std::back_inserter(buf), format_str, fmt::make_format_args(args...));
-  buf.push_back(0);
-  log((const char*)buf.data());
+  char buf[ClapWrapper::detail::shared::log::maxMessage];
+  auto r = fmt::vformat_to_n(buf, sizeof(buf), format_str, fmt::make_format_args(args...));
+  log(CLAP_LOG_INFO, buf, std::min(r.size, sizeof(buf)));
 }
 
 template <typename... Args>
-void logWithLocation(const std::string& file, uint32_t line, const std::string func,
+void logWithLocation(clap_log_severity severity, const char* file, uint32_t line, const char* func,
                      fmt::string_view format_str, Args&&... args)
 {
-  fmt::memory_buffer buf;
-  fmt::vformat_to(std::back_inserter(buf), "{}:{} ({}) ", fmt::make_format_args(file, line, func));
-  fmt::vformat_to(std::back_inserter(buf), format_str, fmt::make_format_args(args...));
-  buf.push_back(0);
-  log((const char*)buf.data());
+  if (!ClapWrapper::detail::shared::log::accepts(severity))
+  {
+    return;
+  }
+  // the full path would take most of the message
+  for (auto p = file; *p; ++p)
+  {
+    if (*p == '/' || *p == '\\') file = p + 1;
+  }
+
+  char buf[ClapWrapper::detail::shared::log::maxMessage];
+  auto r = fmt::format_to_n(buf, sizeof(buf), "{}:{} ({}) ", file, line, func);
+  auto n = std::min(r.size, sizeof(buf));
+  r = fmt::vformat_to_n(buf + n, sizeof(buf) - n, format_str, fmt::make_format_args(args...));
+  n += std::min(r.size, sizeof(buf) - n);
+  log(severity, buf, n);
 }
 }  // namespace os
 
@@ -64,12 +76,12 @@ void logWithLocation(const std::string& file, uint32_t line, const std::string f
 #endif
 
 #if (CLAP_WRAPPER_LOGLEVEL == 1)
-#define LOGINFO os::logWithLocation(__FILE__, __LINE__, __func__, __VA_ARGS__)
+#define LOGINFO(...) os::logWithLocation(CLAP_LOG_INFO, __FILE__, __LINE__, __func__, __VA_ARGS__)
 #define LOGDETAIL(...) (void(0))
 #endif
 
 #if (CLAP_WRAPPER_LOGLEVEL == 2)
-#define LOGINFO(...) os::logWithLocation(__FILE__, __LINE__, __func__, __VA_ARGS__)
-#define LOGDETAIL(...) os::logWithLocation(__FILE__, __LINE__, __func__, __VA_ARGS__)
+#define LOGINFO(...) os::logWithLocation(CLAP_LOG_INFO, __FILE__, __LINE__, __func__, __VA_ARGS__)
+#define LOGDETAIL(...) os::logWithLocation(CLAP_LOG_DEBUG, __FILE__, __LINE__, __func__, __VA_ARGS__)
 #endif
 #endif
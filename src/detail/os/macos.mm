@@ -18,6 +18,7 @@
 #include <vector>
 #include <iostream>
 #include <dlfcn.h>
+#include <time.h>
 
 #include "detail/os/fs.h"
 
@@ -115,9 +116,14 @@ void detach(IPlugObject* plugobject)
   gMacOSHelper.detach(plugobject);
 }
 
+uint64_t getTickInNS()
+{
+  return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+}
+
 uint64_t getTickInMS()
 {
-  return (::clock() * 1000) / CLOCKS_PER_SEC;
+  return getTickInNS() / 1000000ull;
 }
 
 fs::path getPluginPath()
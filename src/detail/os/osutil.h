@@ -5,12 +5,20 @@
 */
 
 #include <atomic>
+#include <cstdint>
 #include <string>
 #include <functional>
 
 #include "log.h"
 #include "fs.h"
 
+#if LIN
+namespace Steinberg::Linux
+{
+class IRunLoop;
+}
+#endif
+
 namespace os
 {
 class State
@@ -57,12 +65,29 @@ class IPlugObject
 {
  public:
   virtual void onIdle() = 0;
+  // the shortest period (ms) of the timers the instance runs from onIdle(), 0 if it has none.
+  // The OS layers call onIdle() regularly anyway, only the Linux layer speeds its idle timer
+  // up for it so far.
+  virtual uint32_t timerPeriod()
+  {
+    return 0;
+  }
   virtual ~IPlugObject()
   {
   }
 };
 void attach(IPlugObject* plugobject);
 void detach(IPlugObject* plugobject);
+
+#if LIN
+// [UI Thread] run loops handed to an instance (by the host context or an editor frame).
+// The module registers one idle timer with the first of them, if that run loop goes away the
+// registration moves to the next one.
+void addRunLoop(Steinberg::Linux::IRunLoop* runloop);
+void removeRunLoop(Steinberg::Linux::IRunLoop* runloop);
+#endif
+// monotonic clock, not affected by changes of the wall clock or by load
+uint64_t getTickInNS();
 uint64_t getTickInMS();
 
 // Used for clap_plugin_entry.init(). Path to DSO (Linux, Windows), or the bundle (macOS).
@@ -152,8 +152,23 @@ void detach(IPlugObject* plugobject)
   gWindowsHelper.detach(plugobject);
 }
 
+uint64_t getTickInNS()
+{
+  static const uint64_t frequency = []()
+  {
+    LARGE_INTEGER f;
+    QueryPerformanceFrequency(&f);
+    return (uint64_t)f.QuadPart;
+  }();
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  const uint64_t ticks = (uint64_t)counter.QuadPart;
+  // split to avoid overflowing ticks * 1e9
+  return (ticks / frequency) * 1000000000ull + ((ticks % frequency) * 1000000000ull) / frequency;
+}
+
 uint64_t getTickInMS()
 {
-  return GetTickCount64();
+  return getTickInNS() / 1000000ull;
 }
 }  // namespace os
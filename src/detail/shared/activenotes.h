@@ -0,0 +1,275 @@
+#pragma once
+
+/*
+    active note table
+
+    keeps track of the notes sent to a plugin, so that per-note events of the host (poly pressure,
+    note expressions) can be routed with the port/channel/key of the matching note.
+
+    The table has a fixed capacity and never allocates after construction. Notes are found by
+    their note_id through a small open addressing table, and by port/channel/key through a
+    direct index. Notes which don't fit anymore are counted as overflows.
+*/
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+
+namespace ClapWrapper::detail::shared
+{
+
+struct ActiveNote
+{
+  int32_t note_id;  // -1 if unspecified, otherwise >=0
+  int16_t port_index;
+  int16_t channel;  // 0..15
+  int16_t key;      // 0..127
+};
+
+class ActiveNoteTable
+{
+ public:
+  static constexpr uint16_t capacity = 256;
+  static constexpr int16_t indexedPorts = 4;
+
+  ActiveNoteTable()
+  {
+    clear();
+  }
+
+  void clear()
+  {
+    _idmap.fill({0, none});
+    _keymap.fill(none);
+    for (uint16_t i = 0; i < capacity; ++i)
+    {
+      _next[i] = i + 1;
+    }
+    _next[capacity - 1] = none;
+    _free = 0;
+    _count = 0;
+  }
+
+  uint32_t size() const
+  {
+    return _count;
+  }
+
+  // number of notes which have been dropped because the table was full
+  uint32_t overflows() const
+  {
+    return _overflows;
+  }
+
+  bool add(int32_t note_id, int16_t port_index, int16_t channel, int16_t key)
+  {
+    const bool byKey = isIndexable(port_index, channel, key);
+    if (note_id < 0 && !byKey)
+    {
+      // there is no way to find this note again
+      return false;
+    }
+    if (note_id >= 0)
+    {
+      // the host reuses a note id, the previous note is gone
+      if (auto slot = findSlot(note_id); slot != none)
+      {
+        release(slot);
+      }
+    }
+    if (_free == none)
+    {
+      ++_overflows;
+      return false;
+    }
+
+    auto slot = _free;
+    _free = _next[slot];
+    _notes[slot] = {note_id, port_index, channel, key};
+    _next[slot] = none;
+
+    if (note_id >= 0)
+    {
+      insertId(note_id, slot);
+    }
+    if (byKey)
+    {
+      // most recent note first
+      auto& head = _keymap[keyIndex(port_index, channel, key)];
+      _next[slot] = head;
+      head = slot;
+    }
+    ++_count;
+    return true;
+  }
+
+  const ActiveNote* findByNoteId(int32_t note_id) const
+  {
+    auto slot = findSlot(note_id);
+    return (slot != none) ? &_notes[slot] : nullptr;
+  }
+
+  const ActiveNote* findByKey(int16_t port_index, int16_t channel, int16_t key) const
+  {
+    if (!isIndexable(port_index, channel, key))
+    {
+      return nullptr;
+    }
+    auto slot = _keymap[keyIndex(port_index, channel, key)];
+    return (slot != none) ? &_notes[slot] : nullptr;
+  }
+
+  // removes the note with the given note_id, or the latest note on port/channel/key if the
+  // note_id is unspecified. A key of -1 removes all notes without note_id on port/channel
+  void remove(int32_t note_id, int16_t port_index, int16_t channel, int16_t key)
+  {
+    if (note_id >= 0)
+    {
+      auto slot = findSlot(note_id);
+      if (slot != none && _notes[slot].port_index == port_index && _notes[slot].channel == channel)
+      {
+        release(slot);
+      }
+      return;
+    }
+    if (key >= 0)
+    {
+      if (isIndexable(port_index, channel, key))
+      {
+        auto slot = _keymap[keyIndex(port_index, channel, key)];
+        if (slot != none)
+        {
+          release(slot);
+        }
+      }
+      return;
+    }
+    if (isIndexable(port_index, channel, 0))
+    {
+      for (int16_t k = 0; k < 128; ++k)
+      {
+        auto& head = _keymap[keyIndex(port_index, channel, k)];
+        while (head != none && _notes[head].note_id < 0)
+        {
+          release(head);
+        }
+      }
+    }
+  }
+
+ private:
+  static constexpr uint16_t none = UINT16_MAX;
+  static constexpr size_t idmapSize = capacity * 2;  // power of two, keeps probing short
+
+  struct IdSlot
+  {
+    int32_t note_id;
+    uint16_t slot;
+  };
+
+  static bool isIndexable(int16_t port_index, int16_t channel, int16_t key)
+  {
+    return port_index >= 0 && port_index < indexedPorts && channel >= 0 && channel < 16 &&
+           key >= 0 && key < 128;
+  }
+
+  static size_t keyIndex(int16_t port_index, int16_t channel, int16_t key)
+  {
+    return ((size_t)port_index * 16 + (size_t)channel) * 128 + (size_t)key;
+  }
+
+  static size_t hash(int32_t note_id)
+  {
+    return ((uint32_t)note_id * 2654435769U) >> 8;
+  }
+
+  uint16_t findSlot(int32_t note_id) const
+  {
+    if (note_id < 0)
+    {
+      return none;
+    }
+    for (auto pos = hash(note_id) & (idmapSize - 1);; pos = (pos + 1) & (idmapSize - 1))
+    {
+      const auto& e = _idmap[pos];
+      if (e.slot == none)
+      {
+        return none;
+      }
+      if (e.note_id == note_id)
+      {
+        return e.slot;
+      }
+    }
+  }
+
+  void insertId(int32_t note_id, uint16_t slot)
+  {
+    auto pos = hash(note_id) & (idmapSize - 1);
+    while (_idmap[pos].slot != none)
+    {
+      pos = (pos + 1) & (idmapSize - 1);
+    }
+    _idmap[pos] = {note_id, slot};
+  }
+
+  void eraseId(int32_t note_id)
+  {
+    auto pos = hash(note_id) & (idmapSize - 1);
+    while (_idmap[pos].slot != none && _idmap[pos].note_id != note_id)
+    {
+      pos = (pos + 1) & (idmapSize - 1);
+    }
+    if (_idmap[pos].slot == none)
+    {
+      return;
+    }
+    // backward shift deletion, so no tombstones are needed
+    auto hole = pos;
+    for (auto i = (hole + 1) & (idmapSize - 1); _idmap[i].slot != none; i = (i + 1) & (idmapSize - 1))
+    {
+      auto home = hash(_idmap[i].note_id) & (idmapSize - 1);
+      if (((i - home) & (idmapSize - 1)) >= ((i - hole) & (idmapSize - 1)))
+      {
+        _idmap[hole] = _idmap[i];
+        hole = i;
+      }
+    }
+    _idmap[hole] = {0, none};
+  }
+
+  void release(uint16_t slot)
+  {
+    const auto& note = _notes[slot];
+    if (note.note_id >= 0)
+    {
+      eraseId(note.note_id);
+    }
+    if (isIndexable(note.port_index, note.channel, note.key))
+    {
+      auto* link = &_keymap[keyIndex(note.port_index, note.channel, note.key)];
+      while (*link != none && *link != slot)
+      {
+        link = &_next[*link];
+      }
+      if (*link == slot)
+      {
+        *link = _next[slot];
+      }
+    }
+    _next[slot] = _free;
+    _free = slot;
+    --_count;
+  }
+
+  std::array<ActiveNote, capacity> _notes{};
+  // free list or the list of notes sharing port/channel/key
+  std::array<uint16_t, capacity> _next{};
+  std::array<IdSlot, idmapSize> _idmap{};
+  std::array<uint16_t, indexedPorts * 16 * 128> _keymap{};
+  uint16_t _free = none;
+  uint32_t _count = 0;
+  uint32_t _overflows = 0;
+};
+
+}  // namespace ClapWrapper::detail::shared
@@ -0,0 +1,89 @@
+#pragma once
+
+/*
+    constant buffer detection
+
+    checks if all samples of a buffer have the same value as the first one, which is the
+    meaning of a set bit in clap_audio_buffer_t::constant_mask. Used by wrappers for hosts
+    which don't provide silence information on their own.
+*/
+
+#include <cstdint>
+
+#ifndef CLAP_WRAPPER_DETECT_CONSTANT_BUFFERS
+#define CLAP_WRAPPER_DETECT_CONSTANT_BUFFERS 0
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLAP_WRAPPER_CONSTANTBUFFER_SSE2 1
+#endif
+
+namespace ClapWrapper::detail::shared
+{
+
+inline bool isConstantBuffer(const float* buffer, uint32_t numSamples)
+{
+  if (numSamples == 0)
+  {
+    return true;
+  }
+  const float first = buffer[0];
+  uint32_t i = 0;
+#if CLAP_WRAPPER_CONSTANTBUFFER_SSE2
+  const auto ref = _mm_set1_ps(first);
+  for (; i + 16 <= numSamples; i += 16)
+  {
+    auto eq = _mm_and_ps(_mm_and_ps(_mm_cmpeq_ps(_mm_loadu_ps(buffer + i), ref),
+                                    _mm_cmpeq_ps(_mm_loadu_ps(buffer + i + 4), ref)),
+                         _mm_and_ps(_mm_cmpeq_ps(_mm_loadu_ps(buffer + i + 8), ref),
+                                    _mm_cmpeq_ps(_mm_loadu_ps(buffer + i + 12), ref)));
+    if (_mm_movemask_ps(eq) != 0xF)
+    {
+      return false;
+    }
+  }
+#endif
+  for (; i < numSamples; ++i)
+  {
+    if (buffer[i] != first)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool isConstantBuffer(const double* buffer, uint32_t numSamples)
+{
+  if (numSamples == 0)
+  {
+    return true;
+  }
+  const double first = buffer[0];
+  uint32_t i = 0;
+#if CLAP_WRAPPER_CONSTANTBUFFER_SSE2
+  const auto ref = _mm_set1_pd(first);
+  for (; i + 8 <= numSamples; i += 8)
+  {
+    auto eq = _mm_and_pd(_mm_and_pd(_mm_cmpeq_pd(_mm_loadu_pd(buffer + i), ref),
+                                    _mm_cmpeq_pd(_mm_loadu_pd(buffer + i + 2), ref)),
+                         _mm_and_pd(_mm_cmpeq_pd(_mm_loadu_pd(buffer + i + 4), ref),
+                                    _mm_cmpeq_pd(_mm_loadu_pd(buffer + i + 6), ref)));
+    if (_mm_movemask_pd(eq) != 0x3)
+    {
+      return false;
+    }
+  }
+#endif
+  for (; i < numSamples; ++i)
+  {
+    if (buffer[i] != first)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace ClapWrapper::detail::shared
@@ -0,0 +1,275 @@
+#pragma once
+
+/*
+    coalescing edit queue
+
+    carries parameter gestures (begin, value, end) from the audio thread to the main thread.
+    Unlike fixedqueue it never overwrites: a push into a full queue is dropped and counted.
+
+    Values of the same parameter are coalesced (last value wins) as long as the main thread
+    hasn't picked them up and no begin or end of that parameter was queued in between, so the
+    order begin/value/end per parameter is kept while a streamed parameter only causes one
+    edit per drain.
+
+    The queue holds a marker pointing to a value cell of the parameter, the value itself is
+    stored in the cell and may be replaced until the consumer reads it. Each parameter has two
+    cells: after a begin or end the producer switches to the other one, so a marker queued
+    before the gesture boundary keeps the value it was queued with.
+
+    Cell states: free -> queued (marker in the queue) -> reading (consumer took the marker) -> free.
+    A producer which finds its cell in "reading" queues a new marker, the consumer then leaves
+    the cell queued.
+
+    Parameters beyond the capacity of the cell table are passed by value without coalescing.
+
+    Single producer (audio thread), single consumer (main thread).
+*/
+
+#include <atomic>
+#include <cstdint>
+
+namespace ClapWrapper::detail::shared
+{
+
+template <uint32_t Q, uint32_t NumParams = 1024>
+class EditQueue
+{
+ public:
+  struct Edit
+  {
+    enum class Type : uint8_t
+    {
+      begin,
+      value,
+      end
+    };
+    Type type = Type::value;
+    uint32_t id = 0;
+    double value = 0.;
+  };
+
+  EditQueue()
+  {
+    for (auto& k : _keys) k = emptyKey;
+  }
+
+  // [audio-thread] these return false if the queue was full and the edit has been dropped
+  bool begin(uint32_t id)
+  {
+    return pushBoundary(Edit::Type::begin, id);
+  }
+
+  bool end(uint32_t id)
+  {
+    return pushBoundary(Edit::Type::end, id);
+  }
+
+  bool value(uint32_t id, double value)
+  {
+    // merging into a queued value needs no room, so this works even if the queue is full
+    auto slot = slotOf(id);
+    if (slot == npos)
+    {
+      return push({Edit::Type::value, id, npos, 0, value});
+    }
+
+    auto& p = _params[slot];
+    if (p.coalescable)
+    {
+      auto& cell = p.cells[p.cell];
+      cell.value.store(value);
+      auto state = cell.state.load();
+      if (state == cellQueued)
+      {
+        _coalesced.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+      // the consumer is done with the cell or is just reading it, it gets a new marker
+      if (!reserve())
+      {
+        return false;
+      }
+      cell.state.store(cellQueued);
+      return push({Edit::Type::value, id, slot, p.cell, 0.});
+    }
+
+    // first value after a gesture boundary: take the other cell if the consumer is done with it
+    const uint8_t next = p.cell ^ 1;
+    auto& cell = p.cells[next];
+    if (cell.state.load() != cellFree)
+    {
+      return push({Edit::Type::value, id, npos, 0, value});
+    }
+    if (!reserve())
+    {
+      return false;
+    }
+    cell.value.store(value);
+    cell.state.store(cellQueued);
+    p.cell = next;
+    p.coalescable = true;
+    return push({Edit::Type::value, id, slot, next, 0.});
+  }
+
+  // [main-thread] hands all edits queued so far to fn(const Edit&), returns their number
+  template <typename Fn>
+  uint32_t drain(Fn fn)
+  {
+    const auto head = _head.load(std::memory_order_acquire);
+    auto tail = _tail.load(std::memory_order_relaxed);
+    uint32_t n = 0;
+    while (tail != head)
+    {
+      const auto& item = _items[tail];
+      Edit e{item.type, item.id, item.value};
+      if (item.type == Edit::Type::value && item.slot != npos)
+      {
+        auto& cell = _params[item.slot].cells[item.cell];
+        cell.state.store(cellReading);
+        e.value = cell.value.load();
+        uint8_t expected = cellReading;
+        cell.state.compare_exchange_strong(expected, cellFree);
+      }
+      tail = (tail + 1) & _wrapMask;
+      _tail.store(tail, std::memory_order_release);
+      fn(e);
+      ++n;
+    }
+    return n;
+  }
+
+  // [thread-safe] statistics
+  uint64_t overflows() const
+  {
+    return _overflows.load(std::memory_order_relaxed);
+  }
+  uint64_t coalesced() const
+  {
+    return _coalesced.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr uint32_t npos = UINT32_MAX;
+  static constexpr uint32_t emptyKey = UINT32_MAX;
+  static constexpr uint8_t cellFree = 0;
+  static constexpr uint8_t cellQueued = 1;
+  static constexpr uint8_t cellReading = 2;
+
+  struct Item
+  {
+    typename Edit::Type type;
+    uint32_t id;
+    uint32_t slot;
+    uint8_t cell;
+    double value;  // only used if slot is npos
+  };
+
+  struct Cell
+  {
+    std::atomic<double> value{0.};
+    std::atomic<uint8_t> state{cellFree};
+  };
+
+  struct Param
+  {
+    Cell cells[2];
+    // audio thread only
+    uint8_t cell = 0;
+    bool coalescable = false;
+  };
+
+  bool full() const
+  {
+    return ((_head.load(std::memory_order_relaxed) + 1) & _wrapMask) ==
+           _tail.load(std::memory_order_acquire);
+  }
+
+  // a cell must only be marked queued if its marker can be pushed, false counts an overflow
+  bool reserve()
+  {
+    if (full())
+    {
+      _overflows.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  bool push(const Item& item)
+  {
+    const auto head = _head.load(std::memory_order_relaxed);
+    const auto next = (head + 1) & _wrapMask;
+    if (next == _tail.load(std::memory_order_acquire))
+    {
+      _overflows.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    _items[head] = item;
+    _head.store(next, std::memory_order_release);
+    return true;
+  }
+
+  bool pushBoundary(typename Edit::Type type, uint32_t id)
+  {
+    if (!push({type, id, npos, 0, 0.}))
+    {
+      return false;
+    }
+    auto slot = slotOf(id);
+    if (slot != npos)
+    {
+      _params[slot].coalescable = false;
+    }
+    return true;
+  }
+
+  // [audio-thread] the cell table is only written by the producer, entries are never removed
+  uint32_t slotOf(uint32_t id)
+  {
+    if (id == emptyKey)
+    {
+      return npos;
+    }
+    auto pos = (uint32_t)((id * 0x9E3779B1u) >> (32 - _paramBits));
+    for (uint32_t i = 0; i < NumParams; ++i)
+    {
+      auto& k = _keys[pos];
+      if (k == id)
+      {
+        return pos;
+      }
+      if (k == emptyKey)
+      {
+        k = id;
+        return pos;
+      }
+      pos = (pos + 1) & (NumParams - 1);
+    }
+    return npos;
+  }
+
+  static constexpr uint32_t bitsOf(uint32_t n)
+  {
+    uint32_t b = 0;
+    while ((1u << b) < n) ++b;
+    return b;
+  }
+  static constexpr uint32_t _paramBits = bitsOf(NumParams);
+  static_assert(NumParams >= 2 && (NumParams & (NumParams - 1)) == 0,
+                "NumParams needs to be a power of 2");
+
+  static constexpr uint32_t _wrapMask = Q - 1;
+  static_assert((Q & _wrapMask) == 0, "Q needs to be a power of 2");
+
+  Item _items[Q] = {};
+  std::atomic_uint32_t _head{0u};
+  std::atomic_uint32_t _tail{0u};
+
+  uint32_t _keys[NumParams];
+  Param _params[NumParams];
+
+  std::atomic<uint64_t> _overflows{0};
+  std::atomic<uint64_t> _coalesced{0};
+};
+
+}  // namespace ClapWrapper::detail::shared
@@ -0,0 +1,167 @@
+#pragma once
+
+/*
+    event arena
+
+    a preallocated buffer which stores CLAP events packed by their header.size, together with
+    a compact list of 32 bit offsets in delivery order. Events are copied in with push(), which
+    never allocates and returns nullptr if the arena is full. clear() resets it for the next block.
+
+    Part of the arena is held back for events which end notes (note off, choke, MIDI note off):
+    other events can't use it, so a block flooded with automation or notes still delivers every
+    note off and leaves no hanging notes. Every event which didn't fit is counted in overflows().
+
+    The offset list can be reordered (e.g. sorted by time) without moving the events themselves.
+*/
+
+#include <clap/events.h>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace ClapWrapper::detail::shared
+{
+
+class EventArena
+{
+ public:
+  // [main-thread] preallocates room for numEvents events using numBytes in total, plus the
+  // headroom for events ending notes
+  void reserve(size_t numEvents, size_t numBytes)
+  {
+    _storage.assign((numBytes + headroomEvents * headroomEventSize + alignment - 1) / alignment, 0);
+    _offsets.clear();
+    _offsets.reserve(numEvents + headroomEvents);
+    _used = 0;
+  }
+
+  void clear()
+  {
+    _offsets.clear();
+    _used = 0;
+  }
+
+  bool empty() const
+  {
+    return _offsets.empty();
+  }
+
+  uint32_t size() const
+  {
+    return (uint32_t)_offsets.size();
+  }
+
+  // the most events the arena can hold, the headroom for events ending notes included
+  size_t capacity() const
+  {
+    return _offsets.capacity();
+  }
+
+  // number of events (other than note offs) which can still be pushed if they are not larger
+  // than maxEventSize
+  size_t remaining(size_t maxEventSize) const
+  {
+    const size_t headroomUnits = headroomEvents * headroomEventSize / alignment;
+    const size_t freeUnits = _storage.size() - _used;
+    const size_t freeEvents = _offsets.capacity() - _offsets.size();
+    if (freeUnits <= headroomUnits || freeEvents <= headroomEvents)
+    {
+      return 0;
+    }
+    auto bytes = (freeUnits - headroomUnits) * alignment / ((maxEventSize + alignment - 1) & ~(alignment - 1));
+    auto events = freeEvents - headroomEvents;
+    return bytes < events ? bytes : events;
+  }
+
+  // copies the event into the arena, returns the copy or nullptr (and counts an overflow) if
+  // there is no room left
+  clap_event_header_t* push(const clap_event_header_t* event)
+  {
+    const size_t units = (event->size + alignment - 1) / alignment;
+    size_t reservedEvents = 0;
+    size_t reservedUnits = 0;
+    if (!endsNote(event))
+    {
+      reservedEvents = headroomEvents;
+      reservedUnits = headroomEvents * headroomEventSize / alignment;
+    }
+    if (_offsets.size() + reservedEvents >= _offsets.capacity() ||
+        _used + units + reservedUnits > _storage.size())
+    {
+      countOverflow();
+      return nullptr;
+    }
+    auto dst = reinterpret_cast<clap_event_header_t*>(_storage.data() + _used);
+    std::memcpy(dst, event, event->size);
+    _offsets.push_back((uint32_t)_used);
+    _used += units;
+    return dst;
+  }
+
+  // for events the caller dropped itself because the arena was running full
+  void countOverflow()
+  {
+    _overflows.store(_overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  // [thread-safe] events which didn't fit since the arena was set up
+  uint32_t overflows() const
+  {
+    return _overflows.load(std::memory_order_relaxed);
+  }
+
+  // the n-th event in delivery order
+  const clap_event_header_t* get(uint32_t index) const
+  {
+    return (index < _offsets.size()) ? at(_offsets[index]) : nullptr;
+  }
+
+  const clap_event_header_t* at(uint32_t offset) const
+  {
+    return reinterpret_cast<const clap_event_header_t*>(_storage.data() + offset);
+  }
+
+  // the delivery order, offsets increase in push order until this is reordered
+  std::vector<uint32_t>& order()
+  {
+    return _offsets;
+  }
+
+ private:
+  // events contain doubles and pointers
+  static constexpr size_t alignment = sizeof(uint64_t);
+  // the room held back for events ending notes
+  static constexpr size_t headroomEvents = 512;
+  static constexpr size_t headroomEventSize = (sizeof(clap_event_note_t) + alignment - 1) & ~(alignment - 1);
+
+  static bool endsNote(const clap_event_header_t* event)
+  {
+    if (event->space_id != CLAP_CORE_EVENT_SPACE_ID)
+    {
+      return false;
+    }
+    switch (event->type)
+    {
+      case CLAP_EVENT_NOTE_OFF:
+      case CLAP_EVENT_NOTE_CHOKE:
+        return true;
+      case CLAP_EVENT_MIDI:
+      {
+        auto midi = reinterpret_cast<const clap_event_midi_t*>(event);
+        auto status = midi->data[0] & 0xF0;
+        return status == 0x80 || (status == 0x90 && midi->data[2] == 0);
+      }
+      default:
+        return false;
+    }
+  }
+
+  std::vector<uint64_t> _storage;
+  std::vector<uint32_t> _offsets;
+  size_t _used = 0;  // in units of alignment
+  std::atomic<uint32_t> _overflows{0};
+};
+
+}  // namespace ClapWrapper::detail::shared
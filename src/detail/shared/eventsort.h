@@ -0,0 +1,144 @@
+#pragma once
+
+/*
+    event index sorting
+
+    the events collected for a block come from sources which are each already ordered by time
+    (the event list of the host, every parameter queue), so the index list consists of a few
+    ascending runs. These runs are merged pairwise instead of sorting the whole list, which
+    is linear for the usual case of a handful of runs and does nothing for already sorted input.
+
+    The merge is stable: events with the same time keep the order they have been added in.
+*/
+
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+namespace ClapWrapper::detail::shared
+{
+
+class EventIndexSorter
+{
+ public:
+  // preallocates the scratch space, call this from a non-realtime thread
+  void reserve(size_t numEvents)
+  {
+    _scratch.reserve(numEvents);
+    _runEnds.reserve(numEvents + 1);
+  }
+
+  // the number of indices sort() handles without allocating
+  size_t capacity() const
+  {
+    return _runEnds.capacity() > 0 ? std::min(_scratch.capacity(), _runEnds.capacity() - 1) : 0;
+  }
+
+  // sorts the indices by the time delivered by timeOf(index), indices must be ascending
+  // within equal times (e.g. offsets in push order) for the merge to stay stable
+  template <typename TimeOf>
+  void sort(std::vector<uint32_t>& indices, TimeOf timeOf)
+  {
+    const auto n = indices.size();
+    if (n < 2)
+    {
+      return;
+    }
+
+    _runEnds.clear();
+    auto lasttime = timeOf(indices[0]);
+    for (size_t i = 1; i < n; ++i)
+    {
+      auto time = timeOf(indices[i]);
+      if (time < lasttime)
+      {
+        _runEnds.push_back(i);
+      }
+      lasttime = time;
+    }
+
+    // fast path: everything is in order already
+    if (_runEnds.empty())
+    {
+      return;
+    }
+    _runEnds.push_back(n);
+
+    _scratch.resize(n);
+    uint32_t* src = indices.data();
+    uint32_t* dst = _scratch.data();
+
+    while (_runEnds.size() > 1)
+    {
+      size_t start = 0;
+      size_t numRuns = 0;
+      for (size_t r = 0; r < _runEnds.size(); r += 2)
+      {
+        const auto mid = _runEnds[r];
+        if (r + 1 < _runEnds.size())
+        {
+          const auto end = _runEnds[r + 1];
+          merge(src, start, mid, end, dst, timeOf);
+          _runEnds[numRuns++] = end;
+          start = end;
+        }
+        else
+        {
+          for (auto i = start; i < mid; ++i)
+          {
+            dst[i] = src[i];
+          }
+          _runEnds[numRuns++] = mid;
+          start = mid;
+        }
+      }
+      _runEnds.resize(numRuns);
+      std::swap(src, dst);
+    }
+
+    if (src != indices.data())
+    {
+      for (size_t i = 0; i < n; ++i)
+      {
+        indices[i] = src[i];
+      }
+    }
+  }
+
+ private:
+  template <typename TimeOf>
+  static void merge(const uint32_t* src, size_t start, size_t mid, size_t end, uint32_t* dst,
+                    TimeOf& timeOf)
+  {
+    auto a = start;
+    auto b = mid;
+    auto o = start;
+    while (a < mid && b < end)
+    {
+      // on equal times the left run wins, it has been added earlier
+      if (timeOf(src[b]) < timeOf(src[a]))
+      {
+        dst[o++] = src[b++];
+      }
+      else
+      {
+        dst[o++] = src[a++];
+      }
+    }
+    while (a < mid)
+    {
+      dst[o++] = src[a++];
+    }
+    while (b < end)
+    {
+      dst[o++] = src[b++];
+    }
+  }
+
+  std::vector<uint32_t> _scratch;
+  std::vector<size_t> _runEnds;
+};
+
+}  // namespace ClapWrapper::detail::shared
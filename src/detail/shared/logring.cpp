@@ -0,0 +1,300 @@
+/*
+    log ring, see logring.h
+
+    The ring is a bounded multi-producer queue in the style of Dmitry Vyukov's: every slot
+    carries a sequence number which tells producers whether the slot is free for the position
+    they claimed and the consumer whether it has been filled. Producers only do a CAS on the
+    enqueue position and copy the text, the consumer side is serialized by a mutex which is
+    never taken on an audio thread.
+*/
+
+#include "logring.h"
+#include "threadrole.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#if WIN
+#include <windows.h>
+#endif
+
+namespace ClapWrapper::detail::shared::log
+{
+
+namespace
+{
+constexpr size_t numSlots = 512;
+// the writer prints at most burstLines at once and linesPerSecond on average
+constexpr double linesPerSecond = 200.;
+constexpr double burstLines = 200.;
+constexpr auto writerPeriod = std::chrono::milliseconds(20);
+
+struct Slot
+{
+  std::atomic<uint64_t> sequence{0};
+  clap_log_severity severity = CLAP_LOG_DEBUG;
+  Source source = Source::wrapper;
+  uint16_t length = 0;
+  char text[maxMessage];
+};
+
+class Ring
+{
+ public:
+  Ring()
+  {
+    for (size_t i = 0; i < numSlots; ++i)
+    {
+      _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  bool push(Source source, clap_log_severity severity, const char* text, size_t length)
+  {
+    auto pos = _enqueue.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;)
+    {
+      slot = &_slots[pos % numSlots];
+      auto sequence = slot->sequence.load(std::memory_order_acquire);
+      auto diff = (int64_t)sequence - (int64_t)pos;
+      if (diff == 0)
+      {
+        if (_enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+      else if (diff < 0)
+      {
+        return false;
+      }
+      else
+      {
+        pos = _enqueue.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->severity = severity;
+    slot->source = source;
+    slot->length = (uint16_t)std::min(length, maxMessage);
+    memcpy(slot->text, text, slot->length);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer only, calls f(slot) for the oldest message if there is one
+  template <typename F>
+  bool pop(F f)
+  {
+    auto& slot = _slots[_dequeue % numSlots];
+    if (slot.sequence.load(std::memory_order_acquire) != _dequeue + 1)
+    {
+      return false;
+    }
+    f(slot);
+    slot.sequence.store(_dequeue + numSlots, std::memory_order_release);
+    ++_dequeue;
+    return true;
+  }
+
+ private:
+  Slot _slots[numSlots];
+  std::atomic<uint64_t> _enqueue{0};
+  uint64_t _dequeue = 0;
+};
+
+Ring ring;
+std::atomic<int32_t> minSeverity{CLAP_LOG_DEBUG};
+std::atomic<uint64_t> dropped{0};
+
+// the consumer side: printing, rate limit and drop reports
+std::mutex consumerLock;
+double tokens = burstLines;
+std::chrono::steady_clock::time_point lastRefill = std::chrono::steady_clock::now();
+std::chrono::steady_clock::time_point lastReport;
+uint64_t reportedDrops = 0;
+
+// the writer thread
+std::mutex writerLock;
+int writerUsers = 0;
+std::thread writer;
+std::atomic<bool> writerRunning{false};
+
+const char* severityName(clap_log_severity severity)
+{
+  switch (severity)
+  {
+    case CLAP_LOG_DEBUG:
+      return "DEBUG: ";
+    case CLAP_LOG_INFO:
+      return "INFO: ";
+    case CLAP_LOG_WARNING:
+      return "WARNING: ";
+    case CLAP_LOG_ERROR:
+      return "ERROR: ";
+    case CLAP_LOG_FATAL:
+      return "FATAL: ";
+    case CLAP_LOG_HOST_MISBEHAVING:
+      return "HOST MISBEHAVING: ";
+    case CLAP_LOG_PLUGIN_MISBEHAVING:
+      return "MISBEHAVING: ";
+  }
+  return "";
+}
+
+void print(Source source, clap_log_severity severity, const char* text, size_t length)
+{
+  // wrapper messages look like they always did, the plugin ones get their severity
+  const char* prefix = (source == Source::plugin) ? "PLUGIN: " : "";
+  const char* name = (source == Source::plugin) ? severityName(severity) : "";
+#if WIN
+  char line[maxMessage + 64];
+  snprintf(line, sizeof(line), "%s%s%.*s\n", prefix, name, (int)length, text);
+  OutputDebugStringA(line);
+#else
+  auto out = (source == Source::plugin) ? stderr : stdout;
+  fprintf(out, "%s%s%.*s\n", prefix, name, (int)length, text);
+#endif
+}
+
+// prints everything in the ring, the caller holds consumerLock
+void drain()
+{
+  auto now = std::chrono::steady_clock::now();
+  tokens = std::min(burstLines,
+                    tokens + std::chrono::duration<double>(now - lastRefill).count() * linesPerSecond);
+  lastRefill = now;
+
+  while (ring.pop(
+      [](const Slot& slot)
+      {
+        // real failures are never reduced to a count of dropped messages
+        const bool limited = slot.severity < CLAP_LOG_ERROR;
+        if (limited && tokens < 1.)
+        {
+          dropped.fetch_add(1, std::memory_order_relaxed);
+          return;
+        }
+        tokens = std::max(tokens - 1., 0.);
+        print(slot.source, slot.severity, slot.text, slot.length);
+      }))
+  {
+  }
+
+  auto drops = dropped.load(std::memory_order_relaxed);
+  if (drops != reportedDrops && now - lastReport >= std::chrono::seconds(1))
+  {
+    char line[96];
+    auto n = snprintf(line, sizeof(line), "[clap-wrapper] log: %llu messages dropped",
+                      (unsigned long long)(drops - reportedDrops));
+    print(Source::wrapper, CLAP_LOG_WARNING, line, (size_t)std::max(n, 0));
+    reportedDrops = drops;
+    lastReport = now;
+  }
+#if !WIN
+  fflush(stdout);
+#endif
+}
+
+void writerMain()
+{
+  while (writerRunning.load(std::memory_order_acquire))
+  {
+    {
+      std::lock_guard<std::mutex> guard(consumerLock);
+      drain();
+    }
+    std::this_thread::sleep_for(writerPeriod);
+  }
+}
+}  // namespace
+
+bool accepts(clap_log_severity severity)
+{
+  return severity >= minSeverity.load(std::memory_order_relaxed);
+}
+
+void setMinSeverity(clap_log_severity severity)
+{
+  minSeverity.store(severity, std::memory_order_relaxed);
+}
+
+void post(Source source, clap_log_severity severity, const char* text, size_t length)
+{
+  if (!accepts(severity))
+  {
+    return;
+  }
+  if (!ring.push(source, severity, text, length))
+  {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // nobody prints the ring, so threads which may block do it themselves
+  if (!writerRunning.load(std::memory_order_acquire) && threadRole() != ThreadRole::audio)
+  {
+    std::lock_guard<std::mutex> guard(consumerLock);
+    drain();
+  }
+}
+
+void flush()
+{
+  std::lock_guard<std::mutex> guard(consumerLock);
+  drain();
+}
+
+uint64_t droppedCount()
+{
+  return dropped.load(std::memory_order_relaxed);
+}
+
+void startWriter()
+{
+  std::lock_guard<std::mutex> guard(writerLock);
+  if (writerUsers++ > 0)
+  {
+    return;
+  }
+  if (auto env = std::getenv("CLAP_WRAPPER_LOG_SEVERITY"))
+  {
+    setMinSeverity((clap_log_severity)std::atoi(env));
+  }
+  writerRunning = true;
+  try
+  {
+    writer = std::thread(writerMain);
+  }
+  catch (const std::system_error&)
+  {
+    // keep printing on the logging threads
+    writerRunning = false;
+  }
+}
+
+void stopWriter()
+{
+  std::lock_guard<std::mutex> guard(writerLock);
+  if (writerUsers == 0 || --writerUsers > 0)
+  {
+    return;
+  }
+  writerRunning = false;
+  if (writer.joinable())
+  {
+    writer.join();
+  }
+
+  std::lock_guard<std::mutex> consumer(consumerLock);
+  drain();
+}
+
+}  // namespace ClapWrapper::detail::shared::log
@@ -0,0 +1,61 @@
+#pragma once
+
+/*
+    log ring
+
+    the messages of clap_host_log and of LOGINFO/LOGDETAIL don't go to the console on the
+    calling thread: producers copy them into a fixed size lock-free ring and a writer thread
+    prints them. Logging from process() therefore neither allocates nor blocks on I/O.
+
+    - messages below the minimum severity are dropped before anything is copied. The
+      minimum is CLAP_LOG_DEBUG unless the environment variable CLAP_WRAPPER_LOG_SEVERITY
+      (a clap_log_severity value) says otherwise.
+    - messages are truncated to maxMessage bytes. If the ring is full the message is dropped
+      and counted, so is every message above the rate limit of the writer, except for errors
+      (CLAP_LOG_ERROR and above) which are always printed. The writer reports the number of
+      dropped messages at most once a second.
+    - the writer runs while at least one startWriter() hasn't been matched by stopWriter()
+      (Clap::Plugin does this for its lifetime). Without a writer, threads which are not
+      tagged as audio threads print the ring themselves, so nothing logged at load or
+      unload time gets lost.
+
+    post(): [thread-safe], doesn't allocate or lock on audio threads
+    flush(): [thread-safe], locks and does I/O
+    startWriter(), stopWriter(): [main-thread]
+*/
+
+#include <clap/ext/log.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ClapWrapper::detail::shared::log
+{
+
+static constexpr size_t maxMessage = 240;
+
+enum class Source : uint8_t
+{
+  wrapper,
+  plugin
+};
+
+// false if messages of this severity are filtered out
+bool accepts(clap_log_severity severity);
+void setMinSeverity(clap_log_severity severity);
+
+// copies text (length bytes, no terminator needed) into the ring
+void post(Source source, clap_log_severity severity, const char* text, size_t length);
+
+// prints everything in the ring now instead of waiting for the writer, e.g. before breaking
+// into the debugger
+void flush();
+
+// messages lost to a full ring or the rate limit so far
+uint64_t droppedCount();
+
+void startWriter();
+// the last stopWriter() prints what is left and joins the writer thread
+void stopWriter();
+
+}  // namespace ClapWrapper::detail::shared::log
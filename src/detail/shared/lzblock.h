@@ -0,0 +1,234 @@
+#pragma once
+
+/*
+    lz block codec
+
+    a small, self-contained LZ77 block compressor in the spirit of LZ4 (same sequence layout,
+    no frame format and no compatibility promise with LZ4 itself). It is meant for plugin
+    states: fast enough to not be noticed when saving a project and good on the repetitive
+    data plugins usually write (zeroed tables, repeated structures, text).
+
+    A block is a list of sequences:
+
+        token       high nibble: number of literals, low nibble: match length - 4
+                    (15 means more length bytes follow, each adding up to 255)
+        literals
+        offset      2 bytes little endian, distance of the match (1..65535)
+
+    The last sequence of a block only has a token and literals.
+
+    decompress() checks every length and offset against its buffers, corrupted input makes
+    it fail but never read or write out of bounds.
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace ClapWrapper::detail::shared
+{
+
+class LzBlockEncoder
+{
+ public:
+  // the size of the largest possible output for size bytes of input
+  static constexpr size_t bound(size_t size)
+  {
+    return size + size / 255 + 16;
+  }
+
+  // returns the compressed size or 0 if the output didn't fit into capacity
+  size_t compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity)
+  {
+    if (_table.empty())
+    {
+      _table.resize(1u << hashBits);
+    }
+    std::fill(_table.begin(), _table.end(), 0u);
+
+    _op = dst;
+    _oend = dst + capacity;
+
+    const uint8_t* ip = src;
+    const uint8_t* anchor = src;
+    const uint8_t* const end = src + size;
+
+    // no matches are started in the last bytes, which also keeps the reads in bounds
+    if (size > minInput)
+    {
+      const uint8_t* const matchLimit = end - lastLiterals;
+      const uint8_t* const startLimit = end - minInput;
+
+      while (ip < startLimit)
+      {
+        const auto sequence = read32(ip);
+        auto& slot = _table[hash(sequence)];
+        const uint8_t* ref = src + slot;
+        slot = (uint32_t)(ip - src);
+
+        if (ref >= ip || ip - ref > maxOffset || read32(ref) != sequence)
+        {
+          // step faster through data which doesn't compress
+          ip += 1 + ((ip - anchor) >> 6);
+          continue;
+        }
+
+        const uint8_t* mend = ip + minMatch;
+        const uint8_t* r = ref + minMatch;
+        while (mend < matchLimit && *mend == *r)
+        {
+          ++mend;
+          ++r;
+        }
+        while (ip > anchor && ref > src && ip[-1] == ref[-1])
+        {
+          --ip;
+          --ref;
+        }
+
+        if (!sequenceOut(anchor, (size_t)(ip - anchor), (size_t)(ip - ref), (size_t)(mend - ip)))
+        {
+          return 0;
+        }
+        ip = mend;
+        anchor = ip;
+      }
+    }
+
+    if (!sequenceOut(anchor, (size_t)(end - anchor), 0, 0))
+    {
+      return 0;
+    }
+    return (size_t)(_op - dst);
+  }
+
+ private:
+  static constexpr uint32_t hashBits = 14;
+  static constexpr size_t minMatch = 4;
+  static constexpr size_t lastLiterals = 5;
+  static constexpr size_t minInput = 12;
+  static constexpr ptrdiff_t maxOffset = 65535;
+
+  static uint32_t read32(const uint8_t* p)
+  {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  static uint32_t hash(uint32_t sequence)
+  {
+    return (sequence * 2654435761u) >> (32 - hashBits);
+  }
+
+  bool lengthOut(size_t length)
+  {
+    while (length >= 255)
+    {
+      if (_op >= _oend) return false;
+      *_op++ = 255;
+      length -= 255;
+    }
+    if (_op >= _oend) return false;
+    *_op++ = (uint8_t)length;
+    return true;
+  }
+
+  // a match length of 0 writes the last sequence
+  bool sequenceOut(const uint8_t* literals, size_t numLiterals, size_t offset, size_t matchLength)
+  {
+    if (_op >= _oend) return false;
+    auto token = _op++;
+    *token = (uint8_t)((numLiterals >= 15 ? 15 : numLiterals) << 4);
+    if (numLiterals >= 15 && !lengthOut(numLiterals - 15)) return false;
+
+    if ((size_t)(_oend - _op) < numLiterals) return false;
+    if (numLiterals > 0)
+    {
+      memcpy(_op, literals, numLiterals);
+      _op += numLiterals;
+    }
+
+    if (matchLength == 0)
+    {
+      return true;
+    }
+
+    if (_oend - _op < 2) return false;
+    *_op++ = (uint8_t)(offset & 0xFF);
+    *_op++ = (uint8_t)(offset >> 8);
+
+    auto ml = matchLength - minMatch;
+    *token |= (uint8_t)(ml >= 15 ? 15 : ml);
+    return ml < 15 || lengthOut(ml - 15);
+  }
+
+  std::vector<uint32_t> _table;
+  uint8_t* _op = nullptr;
+  uint8_t* _oend = nullptr;
+};
+
+// decodes a block which has to expand to exactly size bytes
+inline bool lzBlockDecompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t size)
+{
+  const uint8_t* ip = src;
+  const uint8_t* const iend = src + srcSize;
+  uint8_t* op = dst;
+  uint8_t* const oend = dst + size;
+
+  auto lengthIn = [&](size_t& length)
+  {
+    uint8_t b;
+    do
+    {
+      if (ip >= iend) return false;
+      b = *ip++;
+      length += b;
+    } while (b == 255);
+    return true;
+  };
+
+  while (ip < iend)
+  {
+    const auto token = *ip++;
+
+    size_t numLiterals = token >> 4;
+    if (numLiterals == 15 && !lengthIn(numLiterals)) return false;
+    if (numLiterals > (size_t)(iend - ip) || numLiterals > (size_t)(oend - op)) return false;
+    if (numLiterals > 0)
+    {
+      memcpy(op, ip, numLiterals);
+      ip += numLiterals;
+      op += numLiterals;
+    }
+
+    if (ip == iend)
+    {
+      // the last sequence
+      return op == oend;
+    }
+
+    if (iend - ip < 2) return false;
+    const size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - dst)) return false;
+
+    size_t matchLength = token & 15;
+    if (matchLength == 15 && !lengthIn(matchLength)) return false;
+    matchLength += 4;
+    if (matchLength > (size_t)(oend - op)) return false;
+
+    // matches may overlap the bytes they produce
+    const uint8_t* match = op - offset;
+    for (size_t i = 0; i < matchLength; ++i)
+    {
+      op[i] = match[i];
+    }
+    op += matchLength;
+  }
+  return false;
+}
+
+}  // namespace ClapWrapper::detail::shared
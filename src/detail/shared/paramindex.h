@@ -0,0 +1,152 @@
+#pragma once
+
+/*
+    parameter index helpers
+
+    ParamIndexMap maps parameter ids to a dense index [0..n), using a flat open addressing
+    table. It is built on the main thread and only read on the audio thread.
+
+    GestureTracker keeps one bit per dense index for the parameters currently in a gesture.
+
+    Both don't allocate after they have been set up.
+*/
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace ClapWrapper::detail::shared
+{
+
+class ParamIndexMap
+{
+ public:
+  static constexpr uint32_t npos = UINT32_MAX;
+
+  // [main-thread]
+  template <typename Container>
+  void build(const Container& ids)
+  {
+    size_t capacity = 16;
+    while (capacity < ids.size() * 2)
+    {
+      capacity <<= 1;
+    }
+    _slots.assign(capacity, {0, npos});
+    _mask = capacity - 1;
+    _size = 0;
+    for (auto id : ids)
+    {
+      insert((uint32_t)id, _size++);
+    }
+  }
+
+  void clear()
+  {
+    _slots.clear();
+    _mask = 0;
+    _size = 0;
+  }
+
+  uint32_t size() const
+  {
+    return _size;
+  }
+
+  // returns the dense index of the id or npos
+  uint32_t find(uint32_t id) const
+  {
+    if (_slots.empty())
+    {
+      return npos;
+    }
+    for (auto pos = hash(id) & _mask;; pos = (pos + 1) & _mask)
+    {
+      const auto& slot = _slots[pos];
+      if (slot.index == npos)
+      {
+        return npos;
+      }
+      if (slot.id == id)
+      {
+        return slot.index;
+      }
+    }
+  }
+
+ private:
+  struct Slot
+  {
+    uint32_t id;
+    uint32_t index;
+  };
+
+  static size_t hash(uint32_t id)
+  {
+    // fibonacci hashing, parameter ids are often sequential or hashed already
+    return (size_t)((id * 0x9E3779B97F4A7C15ULL) >> 32);
+  }
+
+  void insert(uint32_t id, uint32_t index)
+  {
+    for (auto pos = hash(id) & _mask;; pos = (pos + 1) & _mask)
+    {
+      auto& slot = _slots[pos];
+      if (slot.index == npos || slot.id == id)
+      {
+        slot = {id, index};
+        return;
+      }
+    }
+  }
+
+  std::vector<Slot> _slots;
+  size_t _mask = 0;
+  uint32_t _size = 0;
+};
+
+class GestureTracker
+{
+ public:
+  // [main-thread]
+  void resize(uint32_t numParams)
+  {
+    _bits.assign((numParams + 63) / 64, 0);
+  }
+
+  bool isActive(uint32_t index) const
+  {
+    return (index / 64 < _bits.size()) && (_bits[index / 64] & bit(index));
+  }
+
+  // returns false if the gesture was already active
+  bool begin(uint32_t index)
+  {
+    if (index / 64 >= _bits.size() || (_bits[index / 64] & bit(index)))
+    {
+      return false;
+    }
+    _bits[index / 64] |= bit(index);
+    return true;
+  }
+
+  // returns false if there was no active gesture
+  bool end(uint32_t index)
+  {
+    if (!isActive(index))
+    {
+      return false;
+    }
+    _bits[index / 64] &= ~bit(index);
+    return true;
+  }
+
+ private:
+  static uint64_t bit(uint32_t index)
+  {
+    return 1ULL << (index & 63);
+  }
+  std::vector<uint64_t> _bits;
+};
+
+}  // namespace ClapWrapper::detail::shared
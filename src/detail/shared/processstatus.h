@@ -0,0 +1,110 @@
+#pragma once
+
+/*
+    process status tracking
+
+    follows the clap_process_status returned by clap_plugin::process() and decides when
+    a wrapper can stop calling the plugin: after CLAP_PROCESS_SLEEP, after the tail has
+    run out (CLAP_PROCESS_TAIL) or once the output went quiet (CLAP_PROCESS_CONTINUE_IF_NOT_QUIET).
+
+    A sleeping plugin is woken up by input events, non-quiet input or requestProcess().
+    The tail length of CLAP_PROCESS_TAIL is measured from the last block with input events or
+    non-quiet input.
+*/
+
+#include <clap/clap.h>
+#include <atomic>
+#include <cstdint>
+
+namespace ClapWrapper::detail::shared
+{
+
+class ProcessStatusTracker
+{
+ public:
+  void reset()
+  {
+    _sleeping = false;
+    _quietSamples = 0;
+    _wakeupRequested = false;
+  }
+
+  // [thread-safe] may be called from clap_host::request_process()
+  void requestProcess()
+  {
+    _wakeupRequested = true;
+  }
+
+  bool isSleeping() const
+  {
+    return _sleeping;
+  }
+
+  // [audio-thread] called before each block, returns false if the plugin call can be skipped
+  bool shouldProcess(bool hasInputEvents, bool inputQuiet)
+  {
+    if (_wakeupRequested.exchange(false) || hasInputEvents || !inputQuiet)
+    {
+      _sleeping = false;
+    }
+    if (hasInputEvents || !inputQuiet)
+    {
+      // the tail is counted from the last event or non-quiet input, instruments have no
+      // audio input and would otherwise start every note with their tail already over
+      _quietSamples = 0;
+    }
+    return !_sleeping;
+  }
+
+  // [audio-thread] called after the plugin processed a block.
+  // isOutputQuiet is only evaluated if the plugin returned CLAP_PROCESS_CONTINUE_IF_NOT_QUIET
+  template <typename OutputQuietFn>
+  void update(clap_process_status status, uint32_t numFrames, bool inputQuiet,
+              const clap_plugin_t* plugin, const clap_plugin_tail_t* ext_tail,
+              OutputQuietFn isOutputQuiet)
+  {
+    if (inputQuiet)
+    {
+      _quietSamples = (_quietSamples > UINT32_MAX - numFrames) ? UINT32_MAX : _quietSamples + numFrames;
+    }
+    else
+    {
+      _quietSamples = 0;
+    }
+
+    switch (status)
+    {
+      case CLAP_PROCESS_SLEEP:
+        _sleeping = true;
+        break;
+      case CLAP_PROCESS_TAIL:
+        if (inputQuiet)
+        {
+          // without the tail extension the plugin has no tail at all
+          auto tail = ext_tail ? ext_tail->get(plugin) : 0;
+          if (tail != UINT32_MAX && _quietSamples >= tail)
+          {
+            _sleeping = true;
+          }
+        }
+        break;
+      case CLAP_PROCESS_CONTINUE_IF_NOT_QUIET:
+        if (inputQuiet && isOutputQuiet())
+        {
+          _sleeping = true;
+        }
+        break;
+      case CLAP_PROCESS_CONTINUE:
+      case CLAP_PROCESS_ERROR:
+      default:
+        break;
+    }
+  }
+
+ private:
+  bool _sleeping = false;
+  uint32_t _quietSamples = 0;
+  std::atomic<bool> _wakeupRequested = false;
+};
+
+}  // namespace ClapWrapper::detail::shared
@@ -0,0 +1,274 @@
+#pragma once
+
+/*
+    process timing
+
+    optional instrumentation of the audio thread, enabled with CLAP_WRAPPER_PROCESS_TIMING.
+    Each block is split into phases (event translation, the plugin call, output translation)
+    and the duration of every phase goes into a log2 histogram of atomic counters. Blocks
+    which took longer than their own duration (numFrames / sampleRate) are counted as overruns.
+
+    The audio thread only increments counters. The main thread drains them into totals and
+    prints a summary to stderr, either when the instance goes away or every N seconds if the
+    environment variable CLAP_WRAPPER_TIMING_DUMP is set to N.
+
+    Besides the timings there are a few plain event counters (e.g. hits of the value text
+    cache) which can be bumped from any thread and are printed with the summary.
+
+    If the instrumentation is disabled all functions are empty and compile to nothing.
+*/
+
+#ifndef CLAP_WRAPPER_PROCESS_TIMING
+#define CLAP_WRAPPER_PROCESS_TIMING 0
+#endif
+
+#include <cstdint>
+
+#if CLAP_WRAPPER_PROCESS_TIMING
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#endif
+
+namespace ClapWrapper::detail::shared
+{
+
+enum class ProcessPhase : uint32_t
+{
+  events = 0,
+  plugin,
+  output,
+  block,  // the whole block, recorded by endBlock()
+  count
+};
+
+enum class ProcessCounter : uint32_t
+{
+  textCacheHits = 0,
+  textCacheMisses,
+  count
+};
+
+#if CLAP_WRAPPER_PROCESS_TIMING
+
+// counts durations in buckets of [2^n, 2^(n+1)) nanoseconds, the last bucket takes everything above
+class TimingHistogram
+{
+ public:
+  static constexpr uint32_t numBuckets = 32;
+
+  // [audio-thread]
+  void record(uint64_t ns)
+  {
+    _buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    auto m = _max.load(std::memory_order_relaxed);
+    while (ns > m && !_max.compare_exchange_weak(m, ns, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  // [main-thread] moves the counters of the audio thread into the totals
+  void drain()
+  {
+    for (uint32_t b = 0; b < numBuckets; ++b)
+    {
+      _totals[b] += _buckets[b].exchange(0, std::memory_order_relaxed);
+    }
+    auto m = _max.exchange(0, std::memory_order_relaxed);
+    if (m > _totalMax) _totalMax = m;
+  }
+
+  uint64_t count() const
+  {
+    uint64_t n = 0;
+    for (auto t : _totals) n += t;
+    return n;
+  }
+
+  uint64_t max() const
+  {
+    return _totalMax;
+  }
+
+  // upper bound of the bucket which contains the given fraction of all samples
+  uint64_t percentile(double fraction) const
+  {
+    const auto n = count();
+    const auto wanted = (uint64_t)(fraction * (double)n);
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < numBuckets; ++b)
+    {
+      seen += _totals[b];
+      if (seen > wanted) return (uint64_t)1 << (b + 1);
+    }
+    return _totalMax;
+  }
+
+  static uint32_t bucketOf(uint64_t ns)
+  {
+    uint32_t b = 0;
+    while (ns > 1 && b < numBuckets - 1)
+    {
+      ns >>= 1;
+      ++b;
+    }
+    return b;
+  }
+
+ private:
+  std::atomic<uint64_t> _buckets[numBuckets] = {};
+  std::atomic<uint64_t> _max{0};
+  uint64_t _totals[numBuckets] = {};
+  uint64_t _totalMax = 0;
+};
+
+class ProcessTiming
+{
+ public:
+  using clock = std::chrono::steady_clock;
+
+  ProcessTiming()
+  {
+    if (auto env = std::getenv("CLAP_WRAPPER_TIMING_DUMP"))
+    {
+      _dumpInterval = std::chrono::seconds(std::atoi(env));
+    }
+    _nextDump = clock::now() + _dumpInterval;
+  }
+
+  // [audio-thread]
+  void beginBlock()
+  {
+    _start = _last = clock::now();
+  }
+
+  // [audio-thread] the time since the previous mark (or beginBlock) is accounted to the phase
+  void mark(ProcessPhase phase)
+  {
+    auto now = clock::now();
+    _phases[(uint32_t)phase].record(nanoseconds(now - _last));
+    _last = now;
+  }
+
+  // [audio-thread]
+  void endBlock(uint32_t numFrames, double sampleRate)
+  {
+    auto duration = nanoseconds(clock::now() - _start);
+    _phases[(uint32_t)ProcessPhase::block].record(duration);
+    if (sampleRate > 0. && (double)duration > (double)numFrames * 1e9 / sampleRate)
+    {
+      _overruns.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  // [thread-safe]
+  void count(ProcessCounter counter, uint64_t n = 1)
+  {
+    _counters[(uint32_t)counter].fetch_add(n, std::memory_order_relaxed);
+  }
+
+  // [main-thread]
+  void drain()
+  {
+    for (auto& p : _phases)
+    {
+      p.drain();
+    }
+    _totalOverruns += _overruns.exchange(0, std::memory_order_relaxed);
+  }
+
+  // [main-thread] drains and prints if the interval of CLAP_WRAPPER_TIMING_DUMP has passed
+  void idle(const char* name)
+  {
+    drain();
+    if (_dumpInterval.count() > 0)
+    {
+      auto now = clock::now();
+      if (now >= _nextDump)
+      {
+        _nextDump = now + _dumpInterval;
+        dump(name);
+      }
+    }
+  }
+
+  // [main-thread]
+  void dump(const char* name)
+  {
+    static const char* phaseNames[] = {"events", "plugin", "output", "block"};
+    static const char* counterNames[] = {"text cache hits", "text cache misses"};
+    drain();
+    for (uint32_t i = 0; i < (uint32_t)ProcessCounter::count; ++i)
+    {
+      if (auto n = _counters[i].load(std::memory_order_relaxed))
+      {
+        fprintf(stderr, "[clap-wrapper] %s of %s: %llu\n", counterNames[i], name ? name : "",
+                (unsigned long long)n);
+      }
+    }
+    auto blocks = _phases[(uint32_t)ProcessPhase::block].count();
+    if (blocks == 0)
+    {
+      return;
+    }
+    fprintf(stderr, "[clap-wrapper] process timing of %s: %llu blocks, %llu overruns\n", name ? name : "",
+            (unsigned long long)blocks, (unsigned long long)_totalOverruns);
+    for (uint32_t i = 0; i < (uint32_t)ProcessPhase::count; ++i)
+    {
+      const auto& p = _phases[i];
+      fprintf(stderr, "  %-7s p50 < %.1fus  p99 < %.1fus  max %.1fus\n", phaseNames[i],
+              p.percentile(0.5) * 1e-3, p.percentile(0.99) * 1e-3, p.max() * 1e-3);
+    }
+  }
+
+ private:
+  static uint64_t nanoseconds(clock::duration d)
+  {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+  }
+
+  // audio thread
+  clock::time_point _start;
+  clock::time_point _last;
+  TimingHistogram _phases[(uint32_t)ProcessPhase::count];
+  std::atomic<uint64_t> _overruns{0};
+  std::atomic<uint64_t> _counters[(uint32_t)ProcessCounter::count] = {};
+
+  // main thread
+  uint64_t _totalOverruns = 0;
+  std::chrono::seconds _dumpInterval{0};
+  clock::time_point _nextDump;
+};
+
+#else
+
+class ProcessTiming
+{
+ public:
+  void beginBlock()
+  {
+  }
+  void mark(ProcessPhase)
+  {
+  }
+  void endBlock(uint32_t, double)
+  {
+  }
+  void count(ProcessCounter, uint64_t = 1)
+  {
+  }
+  void drain()
+  {
+  }
+  void idle(const char*)
+  {
+  }
+  void dump(const char*)
+  {
+  }
+};
+
+#endif
+
+}  // namespace ClapWrapper::detail::shared
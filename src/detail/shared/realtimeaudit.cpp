@@ -0,0 +1,251 @@
+/*
+    realtime audit
+
+    only compiled if CLAP_WRAPPER_AUDIT_REALTIME is set, see realtimeaudit.h
+
+    Nothing in here may allocate or lock while counting, the counters are plain atomics
+    and the thread state is a thread_local integer. If the preload library is present, the
+    scopes are forwarded to it and it counts instead of the operators here, otherwise every
+    allocation made through operator new would be counted twice.
+*/
+
+#include "realtimeaudit.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if LIN
+#include <dlfcn.h>
+#endif
+#if WIN
+#include <malloc.h>
+#endif
+
+namespace ClapWrapper::detail::shared::realtime
+{
+
+namespace
+{
+thread_local int realtimeDepth = 0;
+
+std::atomic<uint64_t> allocations{0};
+
+// read once at load time, a function local static would take a guard lock
+const bool abortOnViolation = (std::getenv("CLAP_WRAPPER_AUDIT_ABORT") != nullptr);
+
+const Hooks* findPreload()
+{
+#if LIN
+  using hooks_fn = const Hooks* (*)();
+  if (auto fn = reinterpret_cast<hooks_fn>(dlsym(RTLD_DEFAULT, hooksSymbol)))
+  {
+    return fn();
+  }
+#endif
+  return nullptr;
+}
+const Hooks* const preload = findPreload();
+
+bool counting()
+{
+  return realtimeDepth > 0 && !preload;
+}
+
+void* alignedAlloc(std::size_t size, std::size_t alignment)
+{
+#if WIN
+  return _aligned_malloc(size ? size : 1, alignment);
+#else
+  void* p = nullptr;
+  if (posix_memalign(&p, std::max(alignment, sizeof(void*)), size ? size : 1) != 0)
+  {
+    return nullptr;
+  }
+  return p;
+#endif
+}
+
+void alignedFree(void* p)
+{
+#if WIN
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+
+void violation(const char* what, std::atomic<uint64_t>& counter)
+{
+  counter.fetch_add(1, std::memory_order_relaxed);
+  if (abortOnViolation)
+  {
+    realtimeDepth = 0;
+    fprintf(stderr, "[clap-wrapper] realtime audit: %s on the audio thread\n", what);
+    std::abort();
+  }
+}
+}  // namespace
+
+void enter()
+{
+  ++realtimeDepth;
+  if (preload)
+  {
+    preload->enter();
+  }
+}
+
+void leave()
+{
+  --realtimeDepth;
+  if (preload)
+  {
+    preload->leave();
+  }
+}
+
+bool isRealtimeThread()
+{
+  return realtimeDepth > 0;
+}
+
+uint64_t allocationCount()
+{
+  return preload ? preload->allocations() : allocations.load(std::memory_order_relaxed);
+}
+
+// locks can only be seen by the preload library
+uint64_t lockCount()
+{
+  return preload ? preload->locks() : 0;
+}
+
+void report(const char* name)
+{
+  auto a = allocationCount();
+  auto l = lockCount();
+  if (a > 0 || l > 0)
+  {
+    fprintf(stderr, "[clap-wrapper] realtime audit of %s: %llu allocations, %llu locks on the audio thread\n",
+            name ? name : "", (unsigned long long)a, (unsigned long long)l);
+  }
+}
+
+}  // namespace ClapWrapper::detail::shared::realtime
+
+namespace rt = ClapWrapper::detail::shared::realtime;
+
+void* operator new(std::size_t size)
+{
+  if (rt::counting())
+  {
+    rt::violation("allocation", rt::allocations);
+  }
+  if (auto p = std::malloc(size ? size : 1))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+  if (rt::counting())
+  {
+    rt::violation("allocation", rt::allocations);
+  }
+  return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+  return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept
+{
+  if (p && rt::counting())
+  {
+    rt::violation("deallocation", rt::allocations);
+  }
+  std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+  operator delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+  operator delete(p);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+  if (rt::counting())
+  {
+    rt::violation("allocation", rt::allocations);
+  }
+  if (auto p = rt::alignedAlloc(size, (std::size_t)alignment))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+  return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+  if (rt::counting())
+  {
+    rt::violation("allocation", rt::allocations);
+  }
+  return rt::alignedAlloc(size, (std::size_t)alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept
+{
+  return operator new(size, alignment, tag);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+  if (p && rt::counting())
+  {
+    rt::violation("deallocation", rt::allocations);
+  }
+  rt::alignedFree(p);
+}
+
+void operator delete[](void* p, std::align_val_t alignment) noexcept
+{
+  operator delete(p, alignment);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+  operator delete(p, alignment);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+  operator delete(p, alignment);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+/*
+    realtime audit
+
+    with CLAP_WRAPPER_AUDIT_REALTIME the wrapper replaces operator new/delete and counts every
+    call made from a thread which is inside a realtime::Scope. The wrappers open such a scope
+    around everything they do on the audio thread, so a non-zero count means the audio path
+    allocated.
+
+    A plugin loaded with dlopen(RTLD_LOCAL) can't replace symbols for the host process, so
+    its operator new only sees the calls the module resolves to itself. On Linux the build
+    therefore also produces a preload library (realtimeaudit_preload.cpp) which interposes
+    malloc & co and pthread_mutex_lock for the whole process:
+
+        LD_PRELOAD=libclap-wrapper-realtime-audit.so <host>
+
+    The wrapper finds it at load time by hooksSymbol and forwards its scopes to it, from
+    then on the preload library does the counting, including locks.
+
+    If the environment variable CLAP_WRAPPER_AUDIT_ABORT is set, the first violation aborts
+    the process - which makes it usable as a hard check in CI.
+
+    Without CLAP_WRAPPER_AUDIT_REALTIME everything here is an empty inline function.
+*/
+
+#ifndef CLAP_WRAPPER_AUDIT_REALTIME
+#define CLAP_WRAPPER_AUDIT_REALTIME 0
+#endif
+
+#include <cstdint>
+
+namespace ClapWrapper::detail::shared::realtime
+{
+
+#if CLAP_WRAPPER_AUDIT_REALTIME
+
+// exported by the preload library as extern "C" const Hooks* clap_wrapper_realtime_hooks()
+struct Hooks
+{
+  void (*enter)();
+  void (*leave)();
+  uint64_t (*allocations)();
+  uint64_t (*locks)();
+};
+constexpr const char* hooksSymbol = "clap_wrapper_realtime_hooks";
+
+// implemented in realtimeaudit.cpp
+void enter();
+void leave();
+bool isRealtimeThread();
+uint64_t allocationCount();
+uint64_t lockCount();
+// prints the counters to stderr if there were any violations
+void report(const char* name);
+
+#else
+
+inline void enter()
+{
+}
+inline void leave()
+{
+}
+inline bool isRealtimeThread()
+{
+  return false;
+}
+inline uint64_t allocationCount()
+{
+  return 0;
+}
+inline uint64_t lockCount()
+{
+  return 0;
+}
+inline void report(const char*)
+{
+}
+
+#endif
+
+// marks the current thread as realtime for the lifetime of the scope, scopes can be nested
+class Scope
+{
+ public:
+  Scope()
+  {
+    enter();
+  }
+  ~Scope()
+  {
+    leave();
+  }
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+};
+
+}  // namespace ClapWrapper::detail::shared::realtime
@@ -0,0 +1,182 @@
+/*
+    realtime audit preload library, see realtimeaudit.h
+
+    built as libclap-wrapper-realtime-audit.so on Linux if CLAP_WRAPPER_AUDIT_REALTIME is set.
+    Loaded with LD_PRELOAD it comes first in the global symbol scope, so its malloc & co and
+    pthread_mutex_lock are called by the host, libstdc++ and every plugin module - even the
+    ones loaded with dlopen(RTLD_LOCAL). The wrapper modules look up hooksSymbol when they
+    are loaded and forward their realtime scopes to this library.
+
+    The allocation functions forward to glibc's __libc_ entry points, looking them up with
+    dlsym() would allocate. The thread state uses the initial-exec TLS model, a preloaded
+    library is part of the static TLS block and reading it never calls into the allocator.
+*/
+
+#include "realtimeaudit.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+
+#include <dlfcn.h>
+#include <pthread.h>
+
+extern "C"
+{
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t count, size_t size);
+  void* __libc_realloc(void* p, size_t size);
+  void* __libc_memalign(size_t alignment, size_t size);
+  void __libc_free(void* p);
+}
+
+#define CLAP_WRAPPER_PRELOAD_EXPORT extern "C" __attribute__((visibility("default")))
+
+namespace
+{
+namespace rt = ClapWrapper::detail::shared::realtime;
+
+__attribute__((tls_model("initial-exec"))) thread_local int realtimeDepth = 0;
+
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> locks{0};
+bool abortOnViolation = false;
+
+using lock_fn = int (*)(pthread_mutex_t*);
+std::atomic<lock_fn> nextLock{nullptr};
+
+void violation(const char* what, std::atomic<uint64_t>& counter)
+{
+  counter.fetch_add(1, std::memory_order_relaxed);
+  if (abortOnViolation)
+  {
+    realtimeDepth = 0;
+    fprintf(stderr, "[clap-wrapper] realtime audit: %s on the audio thread\n", what);
+    std::abort();
+  }
+}
+
+inline void countAllocation()
+{
+  if (realtimeDepth > 0)
+  {
+    violation("allocation", allocations);
+  }
+}
+
+lock_fn resolveLock()
+{
+  auto fn = nextLock.load(std::memory_order_acquire);
+  if (!fn)
+  {
+    fn = reinterpret_cast<lock_fn>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+    nextLock.store(fn, std::memory_order_release);
+  }
+  return fn;
+}
+
+void enter()
+{
+  ++realtimeDepth;
+}
+
+void leave()
+{
+  --realtimeDepth;
+}
+
+uint64_t allocationCount()
+{
+  return allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t lockCount()
+{
+  return locks.load(std::memory_order_relaxed);
+}
+
+const rt::Hooks hooks = {enter, leave, allocationCount, lockCount};
+
+__attribute__((constructor)) void setup()
+{
+  abortOnViolation = (getenv("CLAP_WRAPPER_AUDIT_ABORT") != nullptr);
+  resolveLock();
+}
+
+__attribute__((destructor)) void summary()
+{
+  fprintf(stderr, "[clap-wrapper] realtime audit: %llu allocations, %llu locks on the audio thread\n",
+          (unsigned long long)allocationCount(), (unsigned long long)lockCount());
+}
+}  // namespace
+
+CLAP_WRAPPER_PRELOAD_EXPORT const rt::Hooks* clap_wrapper_realtime_hooks()
+{
+  return &hooks;
+}
+
+CLAP_WRAPPER_PRELOAD_EXPORT void* malloc(size_t size)
+{
+  countAllocation();
+  return __libc_malloc(size);
+}
+
+CLAP_WRAPPER_PRELOAD_EXPORT void* calloc(size_t count, size_t size)
+{
+  countAllocation();
+  return __libc_calloc(count, size);
+}
+
+CLAP_WRAPPER_PRELOAD_EXPORT void* realloc(void* p, size_t size)
+{
+  countAllocation();
+  return __libc_realloc(p, size);
+}
+
+CLAP_WRAPPER_PRELOAD_EXPORT void free(void* p)
+{
+  if (p && realtimeDepth > 0)
+  {
+    violation("deallocation", allocations);
+  }
+  __libc_free(p);
+}
+
+CLAP_WRAPPER_PRELOAD_EXPORT void* memalign(size_t alignment, size_t size)
+{
+  countAllocation();
+  return __libc_memalign(alignment, size);
+}
+
+CLAP_WRAPPER_PRELOAD_EXPORT void* aligned_alloc(size_t alignment, size_t size)
+{
+  countAllocation();
+  return __libc_memalign(alignment, size);
+}
+
+CLAP_WRAPPER_PRELOAD_EXPORT int posix_memalign(void** result, size_t alignment, size_t size)
+{
+  countAllocation();
+  if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+  {
+    return EINVAL;
+  }
+  auto p = __libc_memalign(alignment, size);
+  if (!p)
+  {
+    return ENOMEM;
+  }
+  *result = p;
+  return 0;
+}
+
+CLAP_WRAPPER_PRELOAD_EXPORT int pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+  if (realtimeDepth > 0)
+  {
+    violation("mutex lock", locks);
+  }
+  return resolveLock()(mutex);
+}
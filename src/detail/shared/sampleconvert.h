@@ -0,0 +1,71 @@
+#pragma once
+
+/*
+    sample conversion helpers
+
+    converts blocks of samples between double and float precision, used by wrappers
+    which have to present 32 bit buffers to a CLAP while the host is processing in 64 bit.
+*/
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLAP_WRAPPER_SAMPLECONVERT_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define CLAP_WRAPPER_SAMPLECONVERT_NEON 1
+#endif
+
+namespace ClapWrapper::detail::shared
+{
+
+inline void convertSamples(const double* src, float* dst, uint32_t numSamples)
+{
+  uint32_t i = 0;
+#if CLAP_WRAPPER_SAMPLECONVERT_SSE2
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    auto lo = _mm_cvtpd_ps(_mm_loadu_pd(src + i));
+    auto hi = _mm_cvtpd_ps(_mm_loadu_pd(src + i + 2));
+    _mm_storeu_ps(dst + i, _mm_movelh_ps(lo, hi));
+  }
+#elif CLAP_WRAPPER_SAMPLECONVERT_NEON
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    auto lo = vcvt_f32_f64(vld1q_f64(src + i));
+    auto hi = vcvt_f32_f64(vld1q_f64(src + i + 2));
+    vst1q_f32(dst + i, vcombine_f32(lo, hi));
+  }
+#endif
+  for (; i < numSamples; ++i)
+  {
+    dst[i] = static_cast<float>(src[i]);
+  }
+}
+
+inline void convertSamples(const float* src, double* dst, uint32_t numSamples)
+{
+  uint32_t i = 0;
+#if CLAP_WRAPPER_SAMPLECONVERT_SSE2
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    auto v = _mm_loadu_ps(src + i);
+    _mm_storeu_pd(dst + i, _mm_cvtps_pd(v));
+    _mm_storeu_pd(dst + i + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+  }
+#elif CLAP_WRAPPER_SAMPLECONVERT_NEON
+  for (; i + 4 <= numSamples; i += 4)
+  {
+    auto v = vld1q_f32(src + i);
+    vst1q_f64(dst + i, vcvt_f64_f32(vget_low_f32(v)));
+    vst1q_f64(dst + i + 2, vcvt_high_f64_f32(v));
+  }
+#endif
+  for (; i < numSamples; ++i)
+  {
+    dst[i] = static_cast<double>(src[i]);
+  }
+}
+
+}  // namespace ClapWrapper::detail::shared
@@ -0,0 +1,170 @@
+#pragma once
+
+/*
+    value text cache
+
+    a bounded least-recently-used cache of the texts a plugin returned for parameter values,
+    keyed by the parameter id and the exact bits of the (normalized) value. Hosts ask for the
+    same texts over and over while drawing automation lanes and generic editors, a hit saves
+    the call into the plugin and the UTF-8 to UTF-16 conversion.
+
+    The texts are stored as zero terminated UTF-16 in fixed size entries, the storage is
+    allocated with the first insert and never grows beyond Capacity entries.
+
+    The owner clears the cache whenever the texts may have changed (param rescans) and counts
+    hits and misses itself if it wants to.
+
+    [main-thread] only
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace ClapWrapper::detail::shared
+{
+
+template <uint32_t Capacity = 512, uint32_t Length = 128>
+class ValueTextCache
+{
+ public:
+  // returns the cached text or nullptr, a hit makes the entry the most recently used one
+  const uint16_t* find(uint32_t id, double value)
+  {
+    auto it = _index.find(keyOf(id, value));
+    if (it == _index.end())
+    {
+      return nullptr;
+    }
+    touch(it->second);
+    return _entries[it->second].text;
+  }
+
+  // stores a copy of text (truncated to Length - 1 characters), replaces the least recently
+  // used entry if the cache is full
+  void insert(uint32_t id, double value, const uint16_t* text)
+  {
+    const auto key = keyOf(id, value);
+    auto it = _index.find(key);
+    uint32_t e;
+    if (it != _index.end())
+    {
+      e = it->second;
+      touch(e);
+    }
+    else if (_entries.size() < Capacity)
+    {
+      if (_entries.empty())
+      {
+        _entries.reserve(Capacity);
+        _index.reserve(Capacity);
+      }
+      e = (uint32_t)_entries.size();
+      _entries.emplace_back();
+      _entries[e].key = key;
+      link(e);
+      _index.emplace(key, e);
+    }
+    else
+    {
+      e = _tail;
+      unlink(e);
+      _index.erase(_entries[e].key);
+      _entries[e].key = key;
+      link(e);
+      _index.emplace(key, e);
+    }
+
+    auto& target = _entries[e].text;
+    uint32_t n = 0;
+    while (n < Length - 1 && text[n] != 0)
+    {
+      target[n] = text[n];
+      ++n;
+    }
+    target[n] = 0;
+  }
+
+  // forgets all texts, the storage is kept
+  void clear()
+  {
+    _index.clear();
+    _entries.clear();
+    _head = _tail = npos;
+  }
+
+ private:
+  static constexpr uint32_t npos = UINT32_MAX;
+
+  struct Key
+  {
+    uint32_t id;
+    uint64_t bits;
+    bool operator==(const Key& other) const
+    {
+      return id == other.id && bits == other.bits;
+    }
+  };
+  struct KeyHash
+  {
+    size_t operator()(const Key& k) const
+    {
+      return (size_t)((k.bits ^ ((uint64_t)k.id << 32 | k.id)) * 0x9E3779B97F4A7C15ull);
+    }
+  };
+  struct Entry
+  {
+    Key key{};
+    uint32_t prev = npos;
+    uint32_t next = npos;
+    uint16_t text[Length];
+  };
+
+  static Key keyOf(uint32_t id, double value)
+  {
+    Key k{id, 0};
+    static_assert(sizeof(k.bits) == sizeof(value));
+    memcpy(&k.bits, &value, sizeof(value));
+    return k;
+  }
+
+  // the list runs from the most recently used entry (_head) to the least recently used (_tail)
+  void link(uint32_t e)
+  {
+    _entries[e].prev = npos;
+    _entries[e].next = _head;
+    if (_head != npos) _entries[_head].prev = e;
+    _head = e;
+    if (_tail == npos) _tail = e;
+  }
+
+  void unlink(uint32_t e)
+  {
+    auto& entry = _entries[e];
+    if (entry.prev != npos)
+      _entries[entry.prev].next = entry.next;
+    else
+      _head = entry.next;
+    if (entry.next != npos)
+      _entries[entry.next].prev = entry.prev;
+    else
+      _tail = entry.prev;
+  }
+
+  void touch(uint32_t e)
+  {
+    if (e != _head)
+    {
+      unlink(e);
+      link(e);
+    }
+  }
+
+  std::vector<Entry> _entries;
+  std::unordered_map<Key, uint32_t, KeyHash> _index;
+  uint32_t _head = npos;
+  uint32_t _tail = npos;
+};
+
+}  // namespace ClapWrapper::detail::shared
@@ -0,0 +1,354 @@
+/*
+    thread pool, see threadpool.h
+
+    The job slots are shared between the callers of run() and the workers without locks:
+
+    - a caller claims a free slot, fills it and publishes it by setting it to running. The
+      task indices are handed out by an atomic counter, whoever increments it first (the
+      caller or any worker) runs that task.
+    - a worker registers itself in users before it looks at a slot. When all tasks are done
+      the caller marks the slot finishing and waits for users to drop to zero, so a worker
+      never sees the fields of a slot which is already reused by the next job.
+    - a worker announces itself in _sleeping before checking for work one last time and
+      parking, run() reads _sleeping after publishing its job. Both sides use sequentially
+      consistent operations for this, so either the worker sees the job or run() sees the
+      worker and wakes it.
+*/
+
+#include "threadpool.h"
+#include "realtimeaudit.h"
+#include "threadrole.h"
+
+#include <algorithm>
+#include <mutex>
+#include <system_error>
+
+#if LIN
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#endif
+#if MAC
+#include <dispatch/dispatch.h>
+#include <pthread.h>
+#endif
+#if WIN
+#include <windows.h>
+#include <climits>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+namespace ClapWrapper::detail::shared
+{
+
+namespace
+{
+thread_local bool workerThread = false;
+
+inline void cpuPause()
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  _mm_pause();
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+  __yield();
+#elif defined(__aarch64__) || defined(__arm__)
+  __asm__ __volatile__("yield");
+#endif
+}
+
+// pins the calling worker to a core and raises its priority, both are best effort: without
+// the rights for realtime scheduling the worker just runs with normal priority
+void setupWorkerThread(uint32_t index)
+{
+  const auto cores = std::max(std::thread::hardware_concurrency(), 1u);
+  // core 0 is left to the host's own threads
+  const auto core = (index + 1) % cores;
+
+#if LIN
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+  sched_param param{};
+  param.sched_priority = std::min(sched_get_priority_max(SCHED_FIFO), 70);
+  pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+#endif
+#if MAC
+  // macOS has no hard affinity, the QoS class keeps the workers on the performance cores
+  (void)core;
+  pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
+#endif
+#if WIN
+  if (core < 64)
+  {
+    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core);
+  }
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+#endif
+}
+}  // namespace
+
+// a counting semaphore whose post() is safe on the audio thread
+class ThreadPool::Semaphore
+{
+ public:
+  Semaphore()
+  {
+#if LIN
+    sem_init(&_sem, 0, 0);
+#endif
+#if MAC
+    _sem = dispatch_semaphore_create(0);
+#endif
+#if WIN
+    _sem = CreateSemaphoreA(nullptr, 0, LONG_MAX, nullptr);
+#endif
+  }
+  ~Semaphore()
+  {
+#if LIN
+    sem_destroy(&_sem);
+#endif
+#if MAC
+    dispatch_release(_sem);
+#endif
+#if WIN
+    CloseHandle(_sem);
+#endif
+  }
+
+  void post(uint32_t count)
+  {
+#if LIN
+    for (uint32_t i = 0; i < count; ++i) sem_post(&_sem);
+#endif
+#if MAC
+    for (uint32_t i = 0; i < count; ++i) dispatch_semaphore_signal(_sem);
+#endif
+#if WIN
+    ReleaseSemaphore(_sem, (LONG)count, nullptr);
+#endif
+  }
+
+  void wait()
+  {
+#if LIN
+    while (sem_wait(&_sem) != 0 && errno == EINTR)
+    {
+    }
+#endif
+#if MAC
+    dispatch_semaphore_wait(_sem, DISPATCH_TIME_FOREVER);
+#endif
+#if WIN
+    WaitForSingleObject(_sem, INFINITE);
+#endif
+  }
+
+ private:
+#if LIN
+  sem_t _sem;
+#endif
+#if MAC
+  dispatch_semaphore_t _sem;
+#endif
+#if WIN
+  HANDLE _sem;
+#endif
+};
+
+std::shared_ptr<ThreadPool> ThreadPool::acquire()
+{
+  static std::mutex lock;
+  static std::weak_ptr<ThreadPool> shared;
+
+  std::lock_guard<std::mutex> guard(lock);
+  auto pool = shared.lock();
+  if (!pool)
+  {
+    // the calling audio thread works on its jobs too, so one core less
+    const auto cores = std::thread::hardware_concurrency();
+    pool.reset(new ThreadPool(std::min(cores > 1 ? cores - 1 : 0, maxWorkers)));
+    shared = pool;
+  }
+  return pool;
+}
+
+bool ThreadPool::isWorkerThread()
+{
+  return workerThread;
+}
+
+ThreadPool::ThreadPool(uint32_t numWorkers) : _wake(new Semaphore())
+{
+  _workers.reserve(numWorkers);
+  for (uint32_t i = 0; i < numWorkers; ++i)
+  {
+    try
+    {
+      _workers.emplace_back(&ThreadPool::workerMain, this, i);
+    }
+    catch (const std::system_error&)
+    {
+      // continue with the workers which could be started
+      break;
+    }
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  _running = false;
+  _wake->post((uint32_t)_workers.size());
+  for (auto& w : _workers)
+  {
+    w.join();
+  }
+}
+
+bool ThreadPool::run(Task task, void* context, uint32_t numTasks)
+{
+  if (numTasks == 0)
+  {
+    return true;
+  }
+  if (_workers.empty() || workerThread)
+  {
+    return false;
+  }
+
+  Job* job = nullptr;
+  for (auto& j : _jobs)
+  {
+    uint32_t expected = slotFree;
+    if (j.state.compare_exchange_strong(expected, slotClaimed, std::memory_order_acquire))
+    {
+      job = &j;
+      break;
+    }
+  }
+  if (!job)
+  {
+    return false;
+  }
+
+  job->task = task;
+  job->context = context;
+  job->numTasks = numTasks;
+  job->next.store(0, std::memory_order_relaxed);
+  job->done.store(0, std::memory_order_relaxed);
+  job->state.store(slotRunning, std::memory_order_seq_cst);
+
+  if (numTasks > 1)
+  {
+    auto sleeping = _sleeping.load(std::memory_order_seq_cst);
+    if (sleeping > 0)
+    {
+      _wake->post(std::min(sleeping, numTasks - 1));
+    }
+  }
+
+  while (runOne(*job))
+  {
+  }
+  while (job->done.load(std::memory_order_acquire) < numTasks)
+  {
+    cpuPause();
+  }
+
+  job->state.store(slotFinishing, std::memory_order_seq_cst);
+  while (job->users.load(std::memory_order_seq_cst) > 0)
+  {
+    cpuPause();
+  }
+  job->state.store(slotFree, std::memory_order_release);
+  return true;
+}
+
+bool ThreadPool::runOne(Job& job)
+{
+  auto index = job.next.fetch_add(1, std::memory_order_relaxed);
+  if (index >= job.numTasks)
+  {
+    return false;
+  }
+  job.task(job.context, index);
+  job.done.fetch_add(1, std::memory_order_release);
+  return true;
+}
+
+bool ThreadPool::stealOne(uint32_t start)
+{
+  for (uint32_t i = 0; i < maxJobs; ++i)
+  {
+    auto& job = _jobs[(start + i) % maxJobs];
+    if (job.state.load(std::memory_order_relaxed) != slotRunning)
+    {
+      continue;
+    }
+
+    job.users.fetch_add(1, std::memory_order_seq_cst);
+    bool ran = false;
+    if (job.state.load(std::memory_order_seq_cst) == slotRunning)
+    {
+      realtime::Scope realtime;
+      ran = runOne(job);
+    }
+    job.users.fetch_sub(1, std::memory_order_seq_cst);
+
+    if (ran)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::hasWork() const
+{
+  for (auto& job : _jobs)
+  {
+    if (job.state.load(std::memory_order_seq_cst) == slotRunning)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::workerMain(uint32_t index)
+{
+  workerThread = true;
+  setThreadRole(ThreadRole::audio);
+  setupWorkerThread(index);
+
+  uint32_t idle = 0;
+  while (_running.load(std::memory_order_relaxed))
+  {
+    if (stealOne(index))
+    {
+      idle = 0;
+      continue;
+    }
+    if (++idle < spinIterations)
+    {
+      cpuPause();
+      continue;
+    }
+
+    _sleeping.fetch_add(1, std::memory_order_seq_cst);
+    if (!hasWork() && _running.load(std::memory_order_seq_cst))
+    {
+      _wake->wait();
+    }
+    _sleeping.fetch_sub(1, std::memory_order_relaxed);
+    idle = 0;
+  }
+}
+
+}  // namespace ClapWrapper::detail::shared
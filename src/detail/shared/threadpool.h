@@ -0,0 +1,103 @@
+#pragma once
+
+/*
+    thread pool
+
+    the worker threads behind clap_host_thread_pool::request_exec(). A plugin hands out
+    num_tasks independent tasks from inside its process() call and blocks until all of them
+    ran, so the pool is built for latency and not for throughput:
+
+    - there is one pool per process, shared by all plugin instances which use the extension.
+      It is started by the first acquire() and stopped when the last user releases it.
+    - every run() occupies a job slot. The calling thread works on its own job, idle workers
+      steal task indices from any job in flight, so concurrent calls of several instances
+      (or several host audio threads) share the workers.
+    - workers are pinned to a core each and get realtime priority where the OS allows it.
+      After running out of work they spin for a short while before parking on a semaphore,
+      so back to back requests in the same block don't pay for a wakeup.
+
+    Workers are tagged as audio threads (threadrole.h), isWorkerThread() tells them apart
+    from the host's audio threads.
+
+    run(): [audio-thread], doesn't allocate or lock
+    acquire() and dropping the last reference: [main-thread]
+*/
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace ClapWrapper::detail::shared
+{
+
+class ThreadPool
+{
+ public:
+  using Task = void (*)(void* context, uint32_t index);
+
+  // the shared pool, started if nobody holds it yet
+  static std::shared_ptr<ThreadPool> acquire();
+
+  // true on the worker threads of the pool
+  static bool isWorkerThread();
+
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  uint32_t numWorkers() const
+  {
+    return (uint32_t)_workers.size();
+  }
+
+  // calls task(context, i) for i in [0, numTasks) on the workers and the calling thread and
+  // returns when all calls returned. Returns false without running anything if the pool has
+  // no workers, all job slots are busy or it is called from a worker.
+  bool run(Task task, void* context, uint32_t numTasks);
+
+ private:
+  ThreadPool(uint32_t numWorkers);
+
+  static constexpr uint32_t maxJobs = 16;
+  static constexpr uint32_t maxWorkers = 16;
+  // iterations a worker looks for work before it parks
+  static constexpr uint32_t spinIterations = 4000;
+
+  enum JobState : uint32_t
+  {
+    slotFree,
+    slotClaimed,
+    slotRunning,
+    slotFinishing
+  };
+
+  struct alignas(64) Job
+  {
+    std::atomic<uint32_t> state{slotFree};
+    // workers looking at the job, the slot is only reused once this dropped to zero
+    std::atomic<uint32_t> users{0};
+    Task task = nullptr;
+    void* context = nullptr;
+    uint32_t numTasks = 0;
+    std::atomic<uint32_t> next{0};
+    std::atomic<uint32_t> done{0};
+  };
+
+  class Semaphore;
+
+  // runs one task of job if there is one left
+  static bool runOne(Job& job);
+  bool stealOne(uint32_t start);
+  bool hasWork() const;
+  void workerMain(uint32_t index);
+
+  Job _jobs[maxJobs];
+  std::atomic<uint32_t> _sleeping{0};
+  std::atomic<bool> _running{true};
+  std::unique_ptr<Semaphore> _wake;
+  std::vector<std::thread> _workers;
+};
+
+}  // namespace ClapWrapper::detail::shared
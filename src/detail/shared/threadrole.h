@@ -0,0 +1,94 @@
+#pragma once
+
+/*
+    thread roles
+
+    what a thread is for the plugin: the main thread, an audio thread or neither. The role
+    is a thread_local tag, so answering clap_host_thread_check is a single TLS load and
+    threads never see each other's tags, unlike the shared override counters used before.
+
+    Tags are set by
+    - the construction of a Clap::Plugin (main)
+    - the thread pool workers and the audio callback of the standalone (audio)
+    - AudioThreadEntry at the process entry points of the wrappers: the host's process thread
+      is tagged once when it first enters, only a host calling them from the main thread
+      (offline rendering, the VST3 validator) switches the role for the duration of the call
+    - ThreadRoleScope for calls made on a thread which pretends to be the other one
+
+    Threads nobody tagged (plugin or host background threads, UI threads of the host) are
+    neither main nor audio thread.
+
+    [thread-safe], every function only touches the calling thread's tag
+*/
+
+#include <cstdint>
+
+namespace ClapWrapper::detail::shared
+{
+
+enum class ThreadRole : uint8_t
+{
+  unknown,
+  main,
+  audio
+};
+
+inline thread_local ThreadRole currentThreadRole = ThreadRole::unknown;
+
+inline ThreadRole threadRole()
+{
+  return currentThreadRole;
+}
+
+inline void setThreadRole(ThreadRole role)
+{
+  currentThreadRole = role;
+}
+
+// sets the role of the calling thread and restores the previous one at the end of the scope
+class ThreadRoleScope
+{
+ public:
+  explicit ThreadRoleScope(ThreadRole role) : _previous(currentThreadRole)
+  {
+    currentThreadRole = role;
+  }
+  ~ThreadRoleScope()
+  {
+    currentThreadRole = _previous;
+  }
+  ThreadRoleScope(const ThreadRoleScope&) = delete;
+  ThreadRoleScope& operator=(const ThreadRoleScope&) = delete;
+
+ private:
+  ThreadRole _previous;
+};
+
+// an entry point which runs on the audio thread: an untagged thread becomes an audio thread
+// for good, the main thread only for the scope. On the host's process thread this is a TLS
+// load in the constructor and the destructor.
+class AudioThreadEntry
+{
+ public:
+  AudioThreadEntry() : _wasMain(currentThreadRole == ThreadRole::main)
+  {
+    if (currentThreadRole != ThreadRole::audio)
+    {
+      currentThreadRole = ThreadRole::audio;
+    }
+  }
+  ~AudioThreadEntry()
+  {
+    if (_wasMain)
+    {
+      currentThreadRole = ThreadRole::main;
+    }
+  }
+  AudioThreadEntry(const AudioThreadEntry&) = delete;
+  AudioThreadEntry& operator=(const AudioThreadEntry&) = delete;
+
+ private:
+  bool _wasMain;
+};
+
+}  // namespace ClapWrapper::detail::shared
@@ -0,0 +1,137 @@
+#pragma once
+
+/*
+    timer scheduler
+
+    keeps the CLAP timers of a plugin instance in a min-heap ordered by their next deadline,
+    so the idle handler only looks at timers which are due and can tell when the next one is.
+
+    Unregistered timers are removed lazily: their heap entries carry a generation which
+    doesn't match anymore and are dropped when they come up.
+
+    A timer which missed its deadline fires once and is rescheduled relative to now, there are
+    no bursts to catch up.
+
+    [main-thread] only
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ClapWrapper::detail::shared
+{
+
+class TimerScheduler
+{
+ public:
+  static constexpr uint64_t never = UINT64_MAX;
+
+  // (re)schedules timer id to fire every periodMs, starting at nowMs + periodMs
+  void add(uint32_t id, uint32_t periodMs, uint64_t nowMs)
+  {
+    auto& t = _timers[id];
+    t.period = std::max<uint32_t>(periodMs, 1);
+    ++t.generation;
+    push({nowMs + t.period, id, t.generation});
+  }
+
+  void remove(uint32_t id)
+  {
+    auto it = _timers.find(id);
+    if (it != _timers.end())
+    {
+      // the entry stays, so a timer added again with the same id gets a new generation
+      it->second.period = 0;
+      ++it->second.generation;
+    }
+  }
+
+  // the earliest deadline or never
+  uint64_t nextDeadline()
+  {
+    dropStale();
+    return _heap.empty() ? never : _heap.front().deadline;
+  }
+
+  // the shortest period of the registered timers, 0 if there are none
+  uint32_t shortestPeriod() const
+  {
+    uint32_t shortest = 0;
+    for (auto& t : _timers)
+    {
+      if (t.second.period > 0 && (shortest == 0 || t.second.period < shortest))
+      {
+        shortest = t.second.period;
+      }
+    }
+    return shortest;
+  }
+
+  // calls fire(id) for every timer due at nowMs, fire may add or remove timers
+  template <typename Fire>
+  void run(uint64_t nowMs, Fire fire)
+  {
+    while (nextDeadline() <= nowMs)
+    {
+      auto entry = pop();
+      auto& t = _timers[entry.id];
+      auto next = entry.deadline + t.period;
+      entry.deadline = (next > nowMs) ? next : nowMs + t.period;
+      push(entry);
+      fire(entry.id);
+    }
+  }
+
+ private:
+  struct Timer
+  {
+    uint32_t period = 0;
+    uint32_t generation = 0;
+  };
+  struct Entry
+  {
+    uint64_t deadline;
+    uint32_t id;
+    uint32_t generation;
+  };
+  // std::*_heap build a max-heap, so the comparison is inverted
+  static bool later(const Entry& a, const Entry& b)
+  {
+    return a.deadline > b.deadline;
+  }
+
+  void push(const Entry& e)
+  {
+    _heap.push_back(e);
+    std::push_heap(_heap.begin(), _heap.end(), later);
+  }
+
+  Entry pop()
+  {
+    std::pop_heap(_heap.begin(), _heap.end(), later);
+    auto e = _heap.back();
+    _heap.pop_back();
+    return e;
+  }
+
+  void dropStale()
+  {
+    while (!_heap.empty())
+    {
+      const auto& top = _heap.front();
+      auto it = _timers.find(top.id);
+      if (it != _timers.end() && it->second.period > 0 && it->second.generation == top.generation)
+      {
+        return;
+      }
+      pop();
+    }
+  }
+
+  std::unordered_map<uint32_t, Timer> _timers;
+  std::vector<Entry> _heap;
+};
+
+}  // namespace ClapWrapper::detail::shared
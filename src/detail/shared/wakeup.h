@@ -0,0 +1,87 @@
+#pragma once
+
+/*
+    main thread wakeup
+
+    request_callback() and request_flush() only set a flag which is picked up by the next idle
+    call, which can be up to a timer period later. On Linux this wraps an eventfd the main
+    thread run loop (IRunLoop in VST3, GLib in the standalone) watches, so signal() makes the
+    main thread service the request right away.
+
+    Multiple signals before the main thread gets to drain() collapse into a single wakeup
+    and a single write to the descriptor.
+
+    On other platforms fd() is -1 and signal() does nothing, the idle timer handles requests.
+
+    signal(): [thread-safe], doesn't allocate or lock
+    drain(): [main-thread]
+*/
+
+#include <atomic>
+#include <cstdint>
+
+#if LIN
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace ClapWrapper::detail::shared
+{
+
+class Wakeup
+{
+ public:
+  Wakeup()
+  {
+#if LIN
+    _fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+  }
+  ~Wakeup()
+  {
+#if LIN
+    if (_fd >= 0)
+    {
+      close(_fd);
+    }
+#endif
+  }
+  Wakeup(const Wakeup&) = delete;
+  Wakeup& operator=(const Wakeup&) = delete;
+
+  // the descriptor to watch for reading, -1 if there is none
+  int fd() const
+  {
+    return _fd;
+  }
+
+  void signal()
+  {
+#if LIN
+    if (_fd >= 0 && !_pending.exchange(true, std::memory_order_acq_rel))
+    {
+      uint64_t one = 1;
+      [[maybe_unused]] auto r = write(_fd, &one, sizeof(one));
+    }
+#endif
+  }
+
+  // resets the descriptor, call this before looking at the request flags
+  void drain()
+  {
+#if LIN
+    if (_fd >= 0)
+    {
+      _pending.store(false, std::memory_order_release);
+      uint64_t count;
+      [[maybe_unused]] auto r = read(_fd, &count, sizeof(count));
+    }
+#endif
+  }
+
+ private:
+  int _fd = -1;
+  std::atomic<bool> _pending{false};
+};
+
+}  // namespace ClapWrapper::detail::shared
@@ -114,11 +114,35 @@ void GtkGui::setupPlugin(_GtkApplication *app)
   }
 }
 
+static int gwakeupcb(int, GIOCondition, void *ud)
+{
+  auto g = (GtkGui *)ud;
+  return g->runWakeup();
+}
+
 void GtkGui::initialize(freeaudio::clap_wrapper::standalone::StandaloneHost *sah)
 {
   sah->gtkGui = this;
+  host = sah;
   app = gtk_application_new("org.gtk.example", G_APPLICATION_DEFAULT_FLAGS);
   g_signal_connect(app, "activate", G_CALLBACK(activate), this);
+
+  // request_callback wakes up the main loop directly
+  auto fd = sah->mainThreadWakeup.fd();
+  if (fd >= 0)
+  {
+    wakeupHandle = g_unix_fd_add(fd, G_IO_IN, gwakeupcb, this);
+  }
+}
+
+int GtkGui::runWakeup()
+{
+  host->mainThreadWakeup.drain();
+  if (plugin && host->callbackRequested.exchange(false))
+  {
+    plugin->_plugin->on_main_thread(plugin->_plugin);
+  }
+  return G_SOURCE_CONTINUE;
 }
 
 void GtkGui::setPlugin(std::shared_ptr<Clap::Plugin> p)
@@ -133,6 +157,11 @@ void GtkGui::runloop(int argc, char **argv)
 
 void GtkGui::shutdown()
 {
+  if (wakeupHandle)
+  {
+    g_source_remove(wakeupHandle);
+    wakeupHandle = 0;
+  }
   g_object_unref(app);
 }
 
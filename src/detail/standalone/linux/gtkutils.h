@@ -21,6 +21,10 @@ struct GtkGui
   void runloop(int argc, char **argv);
   void shutdown();
 
+  freeaudio::clap_wrapper::standalone::StandaloneHost *host{nullptr};
+  uint32_t wakeupHandle{0};
+  int runWakeup();
+
   void setupPlugin(_GtkApplication *app);
   bool resizePlugin(_GtkWidget *wid, uint32_t w, uint32_t h);
 
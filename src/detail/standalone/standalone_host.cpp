@@ -1,6 +1,7 @@
 
 #include <cassert>
 #include "standalone_host.h"
+#include "detail/shared/constantbuffer.h"
 #include <fstream>
 
 #if LIN
@@ -108,6 +109,10 @@ void StandaloneHost::clapProcess(void *pOutput, const void *pInput, uint32_t fra
     finishedRunning = true;
     return;
   }
+  ClapWrapper::detail::shared::realtime::Scope realtime;
+  // the audio callback thread belongs to the standalone, so the tag can stay
+  ClapWrapper::detail::shared::setThreadRole(ClapWrapper::detail::shared::ThreadRole::audio);
+  processTiming.beginBlock();
 
   auto f = (float *)pOutput;
   clap_process process;
@@ -207,13 +212,41 @@ void StandaloneHost::clapProcess(void *pOutput, const void *pInput, uint32_t fra
     pushInputEvent(&(midi.header));
   }
 
-  clapPlugin->_plugin->process(clapPlugin->_plugin, &process);
+  auto isQuiet = [frameCount](const float *buffer)
+  { return buffer[0] == 0.f && ClapWrapper::detail::shared::isConstantBuffer(buffer, frameCount); };
+
+  // all other inputs are always cleared
+  bool inputQuiet = true;
+  if (mainInIdx >= 0 && pInput)
+  {
+    inputQuiet = isQuiet(utilityBuffer[mainInIdx]) && isQuiet(utilityBuffer[mainInIdx + 1]);
+  }
+
+  bool clearOutput = true;
+  const bool callPlugin = processStatus.shouldProcess(!eventQueue.empty(), inputQuiet);
+  processTiming.mark(ClapWrapper::detail::shared::ProcessPhase::events);
+  if (callPlugin)
+  {
+    auto status = clapPlugin->_plugin->process(clapPlugin->_plugin, &process);
+    processTiming.mark(ClapWrapper::detail::shared::ProcessPhase::plugin);
+    processStatus.update(
+        status, frameCount, inputQuiet, clapPlugin->_plugin, clapPlugin->_ext._tail,
+        [&]() { return isQuiet(utilityBuffer[mainOutIdx]) && isQuiet(utilityBuffer[mainOutIdx + 1]); });
+    clearOutput = (status == CLAP_PROCESS_ERROR);
+  }
+  if (clearOutput)
+  {
+    memset(utilityBuffer[mainOutIdx], 0, frameCount * sizeof(float));
+    memset(utilityBuffer[mainOutIdx + 1], 0, frameCount * sizeof(float));
+  }
 
   for (auto i = 0U; i < frameCount; ++i)
   {
     f[2 * i] = utilityBuffer[mainOutIdx][i];
     f[2 * i + 1] = utilityBuffer[mainOutIdx + 1][i];
   }
+  processTiming.mark(ClapWrapper::detail::shared::ProcessPhase::output);
+  processTiming.endBlock(frameCount, currentSampleRate);
 }
 
 bool StandaloneHost::gui_can_resize()
@@ -376,6 +409,7 @@ void StandaloneHost::activatePlugin(int32_t sr, int32_t minBlock, int32_t maxBlo
   clapPlugin->setBlockSizes(minBlock, maxBlock);
   clapPlugin->activate();
 
+  processStatus.reset();
   clapPlugin->start_processing();
 
   isActive = true;
@@ -26,6 +26,11 @@
 
 #include "clap_proxy.h"
 #include "detail/shared/fixedqueue.h"
+#include "detail/shared/processstatus.h"
+#include "detail/shared/eventarena.h"
+#include "detail/shared/processtiming.h"
+#include "detail/shared/realtimeaudit.h"
+#include "detail/shared/wakeup.h"
 
 namespace freeaudio::clap_wrapper::standalone
 {
@@ -49,6 +54,7 @@ struct StandaloneHost : Clap::IHost
     inputEvents.get = ie_get;
     outputEvents.ctx = this;
     outputEvents.try_push = oe_try_push;
+    eventQueue.reserve(maxEventsPerCycle, maxEventBytesPerCycle);
   }
   virtual ~StandaloneHost();
 
@@ -69,36 +75,24 @@ struct StandaloneHost : Clap::IHost
   }
 
   static constexpr int maxEventsPerCycle{256};
-  static constexpr int eventSize{1024};
-  static constexpr int queueSize{eventSize * maxEventsPerCycle};
-  const unsigned char eventQueue[queueSize]{};
+  static constexpr int maxEventBytesPerCycle{maxEventsPerCycle * 64};
+  ClapWrapper::detail::shared::EventArena eventQueue;
 
-  int currInput{0};
   void clearInputEvents()
   {
-    currInput = 0;
+    eventQueue.clear();
   }
   bool pushInputEvent(clap_event_header_t *event)
   {
-    if (event->size > eventSize)
-    {
-      return false;
-    }
-    if (currInput >= maxEventsPerCycle)
-    {
-      return false;
-    }
-    memcpy((void *)(eventQueue + currInput * eventSize), (const void *)event, event->size);
-    currInput++;
-    return true;
+    return eventQueue.push(event) != nullptr;
   }
   uint32_t inputEventSize()
   {
-    return currInput;
+    return eventQueue.size();
   }
   const clap_event_header_t *inputEvent(uint32_t idx)
   {
-    return (const clap_event_header_t *)(eventQueue + idx * eventSize);
+    return eventQueue.get(idx);
   }
 
   std::shared_ptr<Clap::Plugin> clapPlugin;
@@ -116,9 +110,17 @@ struct StandaloneHost : Clap::IHost
     TRACE;
   }
   std::atomic<bool> callbackRequested{false};
+  // on linux the gui run loop watches this, elsewhere callbackRequested is polled
+  ClapWrapper::detail::shared::Wakeup mainThreadWakeup;
   void request_callback() override
   {
     callbackRequested = true;
+    mainThreadWakeup.signal();
+  }
+  ClapWrapper::detail::shared::ProcessStatusTracker processStatus;
+  void request_process() override
+  {
+    processStatus.requestProcess();
   }
   void setupWrapperSpecifics(const clap_plugin_t *plugin) override
   {
@@ -242,6 +244,7 @@ struct StandaloneHost : Clap::IHost
 
   // in standalone_host.cpp
   void clapProcess(void *pOutput, const void *pInoput, uint32_t frameCount);
+  ClapWrapper::detail::shared::ProcessTiming processTiming;
 
   // Actual audio IO In standalone_host_audio.cpp
   std::unique_ptr<RtAudio> rtaDac;
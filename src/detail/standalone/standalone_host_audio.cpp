@@ -314,6 +314,11 @@ void StandaloneHost::stopAudioThread()
       rtaDac->stopStream();
       rtaDac->closeStream();
     }
+    if (clapPlugin)
+    {
+      processTiming.dump(clapPlugin->_plugin->desc->name);
+      ClapWrapper::detail::shared::realtime::report(clapPlugin->_plugin->desc->name);
+    }
   }
   return;
 }
@@ -0,0 +1,55 @@
+#include "midiproxies.h"
+#include "parameter.h"
+#include <algorithm>
+
+namespace Clap
+{
+
+void MidiProxies::clear()
+{
+  _proxies.clear();
+  _created.removeAll();
+}
+
+uint32_t MidiProxies::indexOf(Steinberg::Vst::ParamID vst3id) const
+{
+  auto it = std::lower_bound(_proxies.begin(), _proxies.end(), vst3id,
+                             [](const Proxy& p, Steinberg::Vst::ParamID id) { return p.vst3id < id; });
+  if (it == _proxies.end() || it->vst3id != vst3id)
+  {
+    return npos;
+  }
+  return (uint32_t)(it - _proxies.begin());
+}
+
+bool MidiProxies::getInfo(uint32_t index, Steinberg::Vst::ParameterInfo& info) const
+{
+  if (index >= _proxies.size())
+  {
+    return false;
+  }
+  auto& proxy = _proxies[index];
+  info = Vst3Parameter::midiInfo(proxy.controller, proxy.vst3id);
+  info.unitId = _units[proxy.channel];
+  return true;
+}
+
+Vst3Parameter* MidiProxies::get(Steinberg::Vst::ParamID vst3id)
+{
+  if (auto p = _created.getParameter(vst3id))
+  {
+    return static_cast<Vst3Parameter*>(p);
+  }
+  auto index = indexOf(vst3id);
+  if (index == npos)
+  {
+    return nullptr;
+  }
+  auto& proxy = _proxies[index];
+  auto p = Vst3Parameter::create(0, proxy.channel, proxy.controller, vst3id);
+  p->setUnitID(_units[proxy.channel]);
+  _created.addParameter(p);
+  return p;
+}
+
+}  // namespace Clap
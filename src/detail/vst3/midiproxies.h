@@ -0,0 +1,85 @@
+#pragma once
+
+/*
+    MidiProxies
+
+    Copyright (c) 2022 Timo Kaluza (defiantnerd)
+
+    This file is part of the clap-wrappers project which is released under MIT License.
+    See file LICENSE or go to https://github.com/free-audio/clap-wrapper for full license details.
+
+    VST3 has no MIDI controller events, a host sends them as changes of the parameters it gets
+    from IMidiMapping. A plugin with the MIDI dialect therefore needs a parameter for every
+    controller (and the program change) of every MIDI channel - thousands of parameters which
+    are hardly ever looked at.
+
+    MidiProxies only stores the id, channel and controller of each of them. The host enumerates
+    them through the ParameterInfo made on demand, a Vst3Parameter is only created when a
+    proxy is addressed by its id (value, string conversion, ...). The ParameterTable for the
+    audio thread is built from the compact list as well.
+
+    All functions are [main-thread].
+*/
+
+#include <public.sdk/source/vst/vstparameters.h>
+#include <cstdint>
+#include <vector>
+
+class Vst3Parameter;
+
+namespace Clap
+{
+
+class MidiProxies
+{
+ public:
+  static constexpr uint32_t maxChannels = 16;
+  static constexpr uint32_t npos = UINT32_MAX;
+
+  struct Proxy
+  {
+    Steinberg::Vst::ParamID vst3id = 0;
+    uint8_t channel = 0;
+    uint8_t controller = 0;
+  };
+
+  // removes all proxies, the Vst3Parameter objects made for them are released
+  void clear();
+
+  void setUnit(uint8_t channel, Steinberg::Vst::UnitID unit)
+  {
+    _units[channel] = unit;
+  }
+
+  // the ids have to be added in ascending order
+  void add(Steinberg::Vst::ParamID vst3id, uint8_t channel, uint8_t controller)
+  {
+    _proxies.push_back({vst3id, channel, controller});
+  }
+
+  uint32_t size() const
+  {
+    return (uint32_t)_proxies.size();
+  }
+
+  const Proxy& operator[](uint32_t index) const
+  {
+    return _proxies[index];
+  }
+
+  // the index of the proxy with the id or npos
+  uint32_t indexOf(Steinberg::Vst::ParamID vst3id) const;
+
+  // the ParameterInfo of the proxy at index, without creating it
+  bool getInfo(uint32_t index, Steinberg::Vst::ParameterInfo& info) const;
+
+  // the parameter for the proxy with the id, created on the first call or nullptr
+  Vst3Parameter* get(Steinberg::Vst::ParamID vst3id);
+
+ private:
+  std::vector<Proxy> _proxies;
+  Steinberg::Vst::UnitID _units[maxChannels] = {};
+  Steinberg::Vst::ParameterContainer _created;
+};
+
+}  // namespace Clap
@@ -1,5 +1,6 @@
 #include "parameter.h"
 #include <string>
+#include <cstring>
 #include <pluginterfaces/vst/ivstmidicontrollers.h>
 #include <pluginterfaces/vst/ivstunits.h>
 
@@ -14,6 +15,82 @@ static_assert(false, "the CLAP-as-VST3 wrapper requires at least CLAP 1.2.0");
 
 using namespace Steinberg;
 
+void utf8_to_utf16l(const char* utf8string, uint16_t* target, size_t targetsize)
+{
+  uint32_t codepoint = 0;
+  size_t targetpos = 0;
+
+  auto src = reinterpret_cast<const uint8_t*>(utf8string);
+  size_t pos = 0;
+  while (src[pos] && (targetpos < (targetsize - 2)))
+  {
+    auto byte = src[pos];
+
+    if ((byte & 0b10000000) == 0b00000000)
+    {
+      codepoint = byte;
+      pos += 1;
+    }
+    else
+    {
+      if (((byte & 0b11100000) == 0b11000000) && src[1])
+      {
+        codepoint = byte & 0b00011111;
+        codepoint = (codepoint << 6) | ((src[pos + 1]) & 0b00111111);
+        pos += 2;
+      }
+      else if (((byte & 0b11110000) == 0b11100000) && src[1] && src[2])
+      {
+        codepoint = byte & 0b00001111;
+        codepoint = (codepoint << 6) | ((src[pos + 1] & 0b00111111));
+        codepoint = (codepoint << 6) | ((src[pos + 2] & 0b00111111));
+        pos += 3;
+      }
+      else if (((byte & 0b11111000) == 0b11110000) && src[1] && src[2] && src[3])
+      {
+        codepoint = byte & 0b00000111;
+        codepoint = (codepoint << 6) | ((src[pos + 1] & 0b00111111));
+        codepoint = (codepoint << 6) | ((src[pos + 2] & 0b00111111));
+        codepoint = (codepoint << 6) | ((src[pos + 3] & 0b00111111));
+        pos += 4;
+      }
+      else
+      {
+        return;
+      }
+    }
+    {
+      if (codepoint >= 0xD800 && codepoint <= 0xDFFF)
+      {
+        target[targetpos] = 0;
+        return;
+        // throw conversion_error("illegal UTF-32 codepoint (surrogat area)");
+      }
+      if (codepoint <= 0xFFFF)
+      {
+        target[targetpos++] = codepoint;
+      }
+      else
+      {
+        if (codepoint <= 0x10FFFF && (targetpos < (targetsize - 3)))
+        {
+          codepoint -= 0x10000;
+          uint16_t highsurr = static_cast<uint16_t>((codepoint >> 10) + 0xD800);
+          uint16_t lowsurr = static_cast<uint16_t>((codepoint & 0x3FF) + 0xDC00);
+          target[targetpos++] = highsurr;
+          target[targetpos++] = lowsurr;
+        }
+        else
+        {
+          target[targetpos] = 0;
+          return;
+        }
+      }
+    }
+  }
+  target[targetpos] = 0;
+}
+
 Vst3Parameter::Vst3Parameter(const Steinberg::Vst::ParameterInfo& vst3info,
                              const clap_param_info_t* clapinfo)
   : Steinberg::Vst::Parameter(vst3info)
@@ -41,6 +118,18 @@ Vst3Parameter::Vst3Parameter(const Steinberg::Vst::ParameterInfo& vst3info, uint
     max_value = 16383;
   }
 }
+Vst3Parameter::Vst3Parameter(const Vst3Parameter& prototype, void* cookie)
+  : Steinberg::Vst::Parameter(prototype.getInfo())
+  , fingerprint(prototype.fingerprint)
+  , param_index_for_clap_get_info(prototype.param_index_for_clap_get_info)
+  , id(prototype.id)
+  , cookie(cookie)
+  , min_value(prototype.min_value)
+  , max_value(prototype.max_value)
+  , automation_tolerance(prototype.automation_tolerance)
+{
+}
+
 Vst3Parameter::~Vst3Parameter() = default;
 
 bool Vst3Parameter::setNormalized(Steinberg::Vst::ParamValue v)
@@ -60,45 +149,38 @@ bool Vst3Parameter::fromString(const Steinberg::Vst::TChar* string, Steinberg::V
 }
 #endif
 
-Vst3Parameter* Vst3Parameter::create(
-    const clap_param_info_t* info,
-    std::function<Steinberg::Vst::UnitID(const char* modulepath)> getUnitId)
+static uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull)
 {
-  Vst::ParameterInfo v;
-
-  v.id = info->id & 0x7FFFFFFF;  // why ever SMTG does not want the highest bit to be set
-
-  // the long name might contain the module name
-  // this will change when we split the module to units
-  std::string fullname;
-  Vst::UnitID unit = 0;
-
-  // if there is a module name and a lambda
-  if (info->module[0] != 0 && getUnitId)
+  auto bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; ++i)
   {
-    unit = getUnitId(info->module);
-    fullname = info->name;
-  }
-  else
-  {
-    if (!fullname.empty())
-    {
-      fullname.append("/");
-    }
-    fullname.append(info->name);
-    if (fullname.size() >= str16BufferSize(v.title))
-    {
-      fullname = info->name;
-    }
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
   }
+  return hash;
+}
+
+Vst3Parameter::Fingerprint Vst3Parameter::fingerprintOf(const clap_param_info_t* info)
+{
+  Fingerprint result;
+  auto h = fnv1a(info->name, strnlen(info->name, CLAP_NAME_SIZE));
+  h = fnv1a(&info->flags, sizeof(info->flags), h);
+  h = fnv1a(&info->min_value, sizeof(info->min_value), h);
+  h = fnv1a(&info->max_value, sizeof(info->max_value), h);
+  h = fnv1a(&info->default_value, sizeof(info->default_value), h);
+  result.info = h;
+  result.module = fnv1a(info->module, strnlen(info->module, CLAP_PATH_SIZE));
+  return result;
+}
 
-  // str8ToStr16(v.title, fullname.c_str(), str16BufferSize(v.title));
-  utf8_to_utf16l(fullname.c_str(), (uint16_t*)(v.title), str16BufferSize(v.title));
+// fills everything but id and unit
+static void convertInfo(Vst::ParameterInfo& v, const clap_param_info_t* info)
+{
+  // the module is not part of the title, it is mapped to a unit
+  utf8_to_utf16l(info->name, (uint16_t*)(v.title), str16BufferSize(v.title));
   // TODO: string shrink algorithm shortening the string a bit
   // str8ToStr16(v.shortTitle, info->name, str16BufferSize(v.shortTitle));
   utf8_to_utf16l(info->name, (uint16_t*)v.shortTitle, str16BufferSize(v.shortTitle));
   v.units[0] = 0;  // unfortunately, CLAP has no unit for parameter values
-  v.unitId = unit;
 
   /*
 			In the VST3 SDK the normalized value [0, 1] to discrete value and its inverse function discrete value to normalized value is defined like this:
@@ -130,60 +212,93 @@ Vst3Parameter* Vst3Parameter::create(
   }
   else
     v.stepCount = 0;
+}
 
-  auto result = new Vst3Parameter(v, info);
-  result->addRef();  // ParameterContainer doesn't add the ref -> but we don't have copies
-  return result;
+bool Vst3Parameter::update(const clap_param_info_t* clapinfo)
+{
+  auto changed = (clapinfo->min_value != min_value || clapinfo->max_value != max_value ||
+                  clapinfo->cookie != cookie);
+  auto oldSteps = info.stepCount;
+
+  convertInfo(info, clapinfo);
+  min_value = clapinfo->min_value;
+  max_value = clapinfo->max_value;
+  cookie = clapinfo->cookie;
+  fingerprint = fingerprintOf(clapinfo);
+
+  return changed || oldSteps != info.stepCount;
 }
 
-Vst3Parameter* Vst3Parameter::create(uint8_t bus, uint8_t channel, uint8_t cc, Vst::ParamID id)
+Vst3Parameter* Vst3Parameter::create(
+    const clap_param_info_t* info,
+    std::function<Steinberg::Vst::UnitID(const char* modulepath)> getUnitId)
 {
   Vst::ParameterInfo v;
 
-  v.id = id;
+  v.id = info->id & 0x7FFFFFFF;  // why ever SMTG does not want the highest bit to be set
 
-  auto name = "controller";
-  // the long name might contain the module name
-  // this will change when we split the module to units
-  std::string fullname("MIDI");
-  if (!fullname.empty())
-  {
-    fullname.append("/");
-  }
-  fullname.append("controller");
-  if (fullname.size() >= str16BufferSize(v.title))
+  // the module is mapped to a unit
+  Vst::UnitID unit = 0;
+  if (info->module[0] != 0 && getUnitId)
   {
-    fullname = "controller";
+    unit = getUnitId(info->module);
   }
+  v.unitId = unit;
 
-  utf8_to_utf16l(fullname.c_str(), (uint16_t*)(v.title), str16BufferSize(v.title));
-  utf8_to_utf16l(name, (uint16_t*)v.shortTitle, str16BufferSize(v.shortTitle));
+  convertInfo(v, info);
+  auto result = new Vst3Parameter(v, info);
+  result->fingerprint = fingerprintOf(info);
+  result->addRef();  // ParameterContainer doesn't add the ref -> but we don't have copies
+  return result;
+}
 
-  // str8ToStr16(v.title, fullname.c_str(), str16BufferSize(v.title));
-  // TODO: string shrink algorithm shortening the string a bit
-  // str8ToStr16(v.shortTitle, name, str16BufferSize(v.shortTitle));
+Vst3Parameter* Vst3Parameter::create(const Vst3Parameter& prototype, void* cookie)
+{
+  auto result = new Vst3Parameter(prototype, cookie);
+  result->addRef();  // ParameterContainer doesn't add the ref -> but we don't have copies
+  return result;
+}
+
+// the titles and ranges of all MIDI proxies are the same, they are converted only once
+static const Vst::ParameterInfo& midiProxyInfo()
+{
+  static const Vst::ParameterInfo proto = []
+  {
+    Vst::ParameterInfo v;
+    utf8_to_utf16l("MIDI/controller", (uint16_t*)(v.title), str16BufferSize(v.title));
+    utf8_to_utf16l("controller", (uint16_t*)v.shortTitle, str16BufferSize(v.shortTitle));
+    v.units[0] = 0;  // nothing in the "unit" field
+    // the unit will not be set here, but outside
+    v.unitId = 0;
+    v.defaultNormalizedValue = 0;
+    v.flags = Vst::ParameterInfo::kNoFlags;
+    v.stepCount = 127;
+    return v;
+  }();
+  return proto;
+}
 
-  v.units[0] = 0;  // nothing in the "unit" field
-  // the unit will not be set here, but outside
-  // v.unitId = channel + 1;
+Vst::ParameterInfo Vst3Parameter::midiInfo(uint8_t cc, Vst::ParamID id)
+{
+  Vst::ParameterInfo v = midiProxyInfo();
+
+  v.id = id;
 
-  v.defaultNormalizedValue = 0;
-  v.flags = Vst::ParameterInfo::kNoFlags;
   if (cc == Vst::ControllerNumbers::kCtrlProgramChange)
   {
     v.flags |= Vst::ParameterInfo::kIsProgramChange | Vst::ParameterInfo::kCanAutomate;
-    v.stepCount = 127;
   }
 
-  v.defaultNormalizedValue = 0;
-  v.stepCount = 127;
-
   if (cc == Vst::ControllerNumbers::kPitchBend)
   {
     v.stepCount = 16383;
   }
+  return v;
+}
 
-  auto result = new Vst3Parameter(v, bus, channel, cc);
+Vst3Parameter* Vst3Parameter::create(uint8_t bus, uint8_t channel, uint8_t cc, Vst::ParamID id)
+{
+  auto result = new Vst3Parameter(midiInfo(cc, id), bus, channel, cc);
   result->addRef();  // ParameterContainer doesn't add the ref -> but we don't have copies
   return result;
 }
@@ -28,15 +28,28 @@
 #include <functional>
 #include <cmath>
 
+// points of a parameter queue which are closer than this (normalized) distance to the
+// previously sent value are not passed to the CLAP. 0 only drops exact duplicates.
+#ifndef CLAP_WRAPPER_VST3_AUTOMATION_TOLERANCE
+#define CLAP_WRAPPER_VST3_AUTOMATION_TOLERANCE 0.0
+#endif
+
 void utf8_to_utf16l(const char* utf8string, uint16_t* target, size_t targetsize);
 
+namespace Clap
+{
+struct ParameterLayout;
+}
+
 class Vst3Parameter : public Steinberg::Vst::Parameter
 {
   using super = Steinberg::Vst::Parameter;
+  friend struct Clap::ParameterLayout;
 
  protected:
   Vst3Parameter(const Steinberg::Vst::ParameterInfo& vst3info, const clap_param_info_t* clapinfo);
   Vst3Parameter(const Steinberg::Vst::ParameterInfo& vst3info, uint8_t bus, uint8_t channel, uint8_t cc);
+  Vst3Parameter(const Vst3Parameter& prototype, void* cookie);
 
  public:
   virtual ~Vst3Parameter();
@@ -77,6 +90,25 @@ class Vst3Parameter : public Steinberg::Vst::Parameter
   static Vst3Parameter* create(const clap_param_info_t* info,
                                std::function<Steinberg::Vst::UnitID(const char* modulepath)> getUnitId);
   static Vst3Parameter* create(uint8_t bus, uint8_t channel, uint8_t cc, Steinberg::Vst::ParamID id);
+  // the info of a MIDI proxy, without its unit
+  static Steinberg::Vst::ParameterInfo midiInfo(uint8_t cc, Steinberg::Vst::ParamID id);
+  // a copy of a parameter of another instance (see ParameterLayout), only the cookie differs
+  static Vst3Parameter* create(const Vst3Parameter& prototype, void* cookie);
+
+  // hashes of the CLAP info the parameter was made from, a rescan only touches parameters
+  // whose fingerprint changed. A different module requires a new unit tree.
+  struct Fingerprint
+  {
+    uint64_t info = 0;    // name, flags, range and default value
+    uint64_t module = 0;  // module path
+  };
+  static Fingerprint fingerprintOf(const clap_param_info_t* info);
+  Fingerprint fingerprint;
+
+  // applies a changed info of the same parameter in the same module,
+  // returns true if the value conversion or the cookie changed
+  bool update(const clap_param_info_t* info);
+
   // copies from the clap_param_info_t
   uint32_t param_index_for_clap_get_info = 0;
   clap_id id = 0;
@@ -88,4 +120,7 @@ class Vst3Parameter : public Steinberg::Vst::Parameter
   bool isMidi = false;
   uint8_t channel = 0;
   uint8_t controller = 0;
+
+  // thinning of dense automation, see CLAP_WRAPPER_VST3_AUTOMATION_TOLERANCE
+  double automation_tolerance = CLAP_WRAPPER_VST3_AUTOMATION_TOLERANCE;
 };
@@ -0,0 +1,77 @@
+#include "parameterlayout.h"
+
+namespace Clap
+{
+
+ParameterLayout::Entry ParameterLayout::entryOf(uint32_t index, const clap_param_info_t* info)
+{
+  Entry result;
+  result.index = index;
+  if (info)
+  {
+    result.valid = true;
+    result.id = info->id;
+    result.fingerprint = Vst3Parameter::fingerprintOf(info);
+  }
+  return result;
+}
+
+uint64_t ParameterLayout::hash(const std::vector<Entry>& entries)
+{
+  uint64_t h = 0xcbf29ce484222325ull;
+  for (auto& e : entries)
+  {
+    for (uint64_t v : {(uint64_t)e.index, (uint64_t)e.valid, (uint64_t)e.id, e.fingerprint.info,
+                       e.fingerprint.module})
+    {
+      h = (h ^ v) * 0x100000001b3ull;
+    }
+  }
+  return h;
+}
+
+void ParameterLayout::addPrototype(const Vst3Parameter& param)
+{
+  parameters.emplace_back(Steinberg::owned(new Vst3Parameter(param, nullptr)));
+}
+
+ParameterLayoutCache& ParameterLayoutCache::get()
+{
+  static ParameterLayoutCache cache;
+  return cache;
+}
+
+std::shared_ptr<const ParameterLayout> ParameterLayoutCache::find(const char* pluginId,
+                                                                  uint64_t layoutHash)
+{
+  std::lock_guard<std::mutex> guard(_lock);
+  auto it = _layouts.find({pluginId, layoutHash});
+  if (it == _layouts.end())
+  {
+    return nullptr;
+  }
+  auto layout = it->second.lock();
+  if (!layout)
+  {
+    _layouts.erase(it);
+  }
+  return layout;
+}
+
+void ParameterLayoutCache::insert(const char* pluginId, uint64_t layoutHash,
+                                  std::shared_ptr<const ParameterLayout> layout)
+{
+  std::lock_guard<std::mutex> guard(_lock);
+
+  // drop the entries of layouts nobody uses anymore
+  for (auto it = _layouts.begin(); it != _layouts.end();)
+  {
+    if (it->second.expired())
+      it = _layouts.erase(it);
+    else
+      ++it;
+  }
+  _layouts[{pluginId, layoutHash}] = layout;
+}
+
+}  // namespace Clap
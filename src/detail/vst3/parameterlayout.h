@@ -0,0 +1,95 @@
+#pragma once
+
+/*
+    ParameterLayout
+
+    This file is part of the clap-wrappers project which is released under MIT License.
+    See file LICENSE or go to https://github.com/free-audio/clap-wrapper for full license details.
+
+    Instances of the same CLAP usually have exactly the same parameters. The conversion of
+    the CLAP infos to VST3 (UTF-16 titles, flags, ranges and the unit tree built from the
+    module paths) is therefore done once per layout and shared by all instances of the module.
+
+    A layout is looked up by the plugin id and a hash over the entries of all parameter
+    indices, an index whose get_info() failed is part of it as well. The hash only finds the
+    candidate: the layout keeps the entries (index, id and fingerprint) it was made from and
+    is only used if they are the same as the ones of the instance, so an instance which
+    reports different parameters gets its own layout even if the hashes collide.
+    Layouts are immutable: an instance copies the prototypes into its own Vst3Parameter
+    objects and changes of a rescan only touch those copies (or lead to another layout).
+
+    The cache only holds weak references, a layout goes away with the last instance using it.
+
+    [main-thread] except for the cache itself, which is guarded by a mutex.
+*/
+
+#include <clap/clap.h>
+#include <public.sdk/source/vst/vstparameters.h>
+#include <pluginterfaces/vst/ivstunits.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "parameter.h"
+
+namespace Clap
+{
+
+struct ParameterLayout
+{
+  // what the layout knows about a parameter index of the CLAP
+  struct Entry
+  {
+    uint32_t index = 0;
+    bool valid = false;  // false if get_info() failed for the index
+    clap_id id = CLAP_INVALID_ID;
+    Vst3Parameter::Fingerprint fingerprint;
+
+    bool operator==(const Entry& other) const
+    {
+      return index == other.index && valid == other.valid && id == other.id &&
+             fingerprint.info == other.fingerprint.info &&
+             fingerprint.module == other.fingerprint.module;
+    }
+  };
+  // info is nullptr if get_info() failed
+  static Entry entryOf(uint32_t index, const clap_param_info_t* info);
+
+  // all indices of the CLAP the layout was made from
+  std::vector<Entry> entries;
+  // prototypes of the parameters in the order of the CLAP, they are never handed to a host
+  std::vector<Steinberg::IPtr<Vst3Parameter>> parameters;
+  // the units below the root unit in the order they were created
+  std::vector<Steinberg::Vst::UnitInfo> units;
+  std::map<std::string, Steinberg::Vst::UnitID> moduleToUnit;
+
+  // stores a copy of the parameter of an instance as prototype
+  void addPrototype(const Vst3Parameter& param);
+
+  // hash over everything a layout depends on
+  static uint64_t hash(const std::vector<Entry>& entries);
+
+  // true if the layout was made from exactly these entries
+  bool matches(const std::vector<Entry>& other) const
+  {
+    return entries == other;
+  }
+};
+
+class ParameterLayoutCache
+{
+ public:
+  // the cache of the module
+  static ParameterLayoutCache& get();
+
+  std::shared_ptr<const ParameterLayout> find(const char* pluginId, uint64_t layoutHash);
+  void insert(const char* pluginId, uint64_t layoutHash, std::shared_ptr<const ParameterLayout> layout);
+
+ private:
+  std::mutex _lock;
+  std::map<std::pair<std::string, uint64_t>, std::weak_ptr<const ParameterLayout>> _layouts;
+};
+
+}  // namespace Clap
@@ -0,0 +1,104 @@
+#include "parametertable.h"
+#include "parameter.h"
+#include <pluginterfaces/vst/ivstmidicontrollers.h>
+
+namespace Clap
+{
+
+ParameterTable::ParameterTable(Steinberg::Vst::ParameterContainer& parameters,
+                               const MidiProxies& midiProxies)
+{
+  auto numParams = parameters.getParameterCount();
+  std::vector<Steinberg::Vst::ParamID> ids;
+  ids.reserve(numParams + midiProxies.size());
+  _slots.reserve(numParams + midiProxies.size());
+
+  for (decltype(numParams) i = 0; i < numParams; ++i)
+  {
+    auto param = static_cast<Vst3Parameter*>(parameters.getParameterByIndex(i));
+    auto& info = param->getInfo();
+
+    ParameterSlot slot;
+    slot.vst3id = info.id;
+    slot.id = param->id;
+    slot.cookie = param->cookie;
+    slot.stepCount = info.stepCount;
+    slot.min_value = param->min_value;
+    slot.toClap = (info.stepCount > 0) ? info.stepCount : (param->max_value - param->min_value);
+    slot.toVst3 = (slot.toClap != 0.) ? 1. / slot.toClap : 0.;
+    slot.automation_tolerance = param->automation_tolerance;
+    slot.isMidi = param->isMidi;
+    slot.channel = param->channel;
+    slot.controller = param->controller;
+
+    ids.push_back(info.id);
+    _slots.push_back(slot);
+  }
+
+  // the same conversion as the Vst3Parameter of a proxy would do, see Vst3Parameter::midiInfo()
+  for (uint32_t i = 0; i < midiProxies.size(); ++i)
+  {
+    auto& proxy = midiProxies[i];
+
+    ParameterSlot slot;
+    slot.vst3id = proxy.vst3id;
+    slot.id = proxy.vst3id;
+    slot.stepCount = (proxy.controller == Steinberg::Vst::ControllerNumbers::kPitchBend) ? 16383 : 127;
+    slot.min_value = 0.;
+    slot.toClap = slot.stepCount;
+    slot.toVst3 = 1. / slot.toClap;
+    slot.automation_tolerance = CLAP_WRAPPER_VST3_AUTOMATION_TOLERANCE;
+    slot.isMidi = true;
+    slot.channel = proxy.channel;
+    slot.controller = proxy.controller;
+
+    ids.push_back(proxy.vst3id);
+    _slots.push_back(slot);
+  }
+
+  _index.build(ids);
+}
+
+ParameterTablePublisher::~ParameterTablePublisher()
+{
+  // the audio thread is gone at this point
+  delete _current.load();
+  for (auto t : _retired)
+  {
+    delete t;
+  }
+}
+
+void ParameterTablePublisher::publish(std::unique_ptr<ParameterTable> table)
+{
+  auto previous = _current.exchange(table.release());
+  if (previous)
+  {
+    _retired.push_back(previous);
+  }
+  reclaim();
+}
+
+void ParameterTablePublisher::reclaim()
+{
+  if (_retired.empty())
+  {
+    return;
+  }
+  auto inUse = _hazard.load();
+  auto it = _retired.begin();
+  while (it != _retired.end())
+  {
+    if (*it != inUse)
+    {
+      delete *it;
+      it = _retired.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+}  // namespace Clap
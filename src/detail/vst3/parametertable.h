@@ -0,0 +1,213 @@
+#pragma once
+
+/*
+    ParameterTable
+
+    Copyright (c) 2022 Timo Kaluza (defiantnerd)
+
+    This file is part of the clap-wrappers project which is released under MIT License.
+    See file LICENSE or go to https://github.com/free-audio/clap-wrapper for full license details.
+
+    The ParameterContainer holding the Vst3Parameter objects is rebuilt on the main thread
+    when the CLAP rescans its parameters. The audio thread therefore doesn't touch it, but
+    reads an immutable ParameterTable with everything needed for the conversion of values.
+
+    A new table is published by the main thread with a single atomic store. The audio thread
+    announces the table it is reading in a hazard pointer, retired tables are only deleted
+    once the audio thread doesn't refer to them anymore.
+
+    There is exactly one reader at a time: process() and flush() are serialized by the wrapper.
+
+    The parameters in a gesture are not part of the table: a gesture has to be ended towards
+    the host even if the table was republished meanwhile, so OpenGestures tracks them by their
+    CLAP id. It is owned by the wrapper and shared by the process and the flush adapter.
+*/
+
+#include <clap/clap.h>
+#include <public.sdk/source/vst/vstparameters.h>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "../shared/paramindex.h"
+#include "midiproxies.h"
+
+namespace Clap
+{
+
+struct ParameterSlot
+{
+  Steinberg::Vst::ParamID vst3id = 0;
+  clap_id id = 0;
+  void* cookie = nullptr;
+
+  // see Vst3Parameter::asClapValue() and Vst3Parameter::asVst3Value()
+  int32_t stepCount = 0;
+  double min_value = 0.;
+  double toClap = 1.;  // stepCount or range
+  double toVst3 = 1.;  // 1 / toClap
+
+  double automation_tolerance = 0.;
+
+  bool isMidi = false;
+  uint8_t channel = 0;
+  uint8_t controller = 0;
+
+  inline double asClapValue(double vst3value) const
+  {
+    return vst3value * toClap + min_value;
+  }
+  inline double asVst3Value(double clapvalue) const
+  {
+    if (stepCount > 0)
+    {
+      return floor(clapvalue - min_value) / float(stepCount);
+    }
+    return (clapvalue - min_value) * toVst3;
+  }
+};
+
+class ParameterTable
+{
+ public:
+  // [main-thread] the CLAP parameters followed by the MIDI proxies
+  ParameterTable(Steinberg::Vst::ParameterContainer& parameters, const MidiProxies& midiProxies);
+
+  uint32_t size() const
+  {
+    return (uint32_t)_slots.size();
+  }
+
+  // returns the dense index of a VST3 parameter id or ParamIndexMap::npos
+  uint32_t indexOf(Steinberg::Vst::ParamID id) const
+  {
+    return _index.find(id);
+  }
+
+  const ParameterSlot& operator[](uint32_t index) const
+  {
+    return _slots[index];
+  }
+
+ private:
+  ClapWrapper::detail::shared::ParamIndexMap _index;
+  std::vector<ParameterSlot> _slots;
+};
+
+// [audio-thread] only touched inside process() and flush(), doesn't allocate
+class OpenGestures
+{
+ public:
+  // more parameters in a gesture at once are not reported to the host
+  static constexpr uint32_t capacity = 64;
+
+  bool isActive(clap_id id) const
+  {
+    return _count > 0 && find(id) < _count;
+  }
+
+  // returns false if the gesture was already active or there is no room for it
+  bool begin(clap_id id, Steinberg::Vst::ParamID vst3id)
+  {
+    if (_count == capacity || isActive(id))
+    {
+      return false;
+    }
+    _entries[_count++] = {id, vst3id};
+    return true;
+  }
+
+  // returns false if there was no active gesture, otherwise vst3id is the id the gesture was
+  // begun with, even if the parameter has gone in the meantime
+  bool end(clap_id id, Steinberg::Vst::ParamID& vst3id)
+  {
+    auto i = find(id);
+    if (i == _count)
+    {
+      return false;
+    }
+    vst3id = _entries[i].vst3id;
+    _entries[i] = _entries[--_count];
+    return true;
+  }
+
+ private:
+  uint32_t find(clap_id id) const
+  {
+    uint32_t i = 0;
+    while (i < _count && _entries[i].id != id) ++i;
+    return i;
+  }
+
+  struct Entry
+  {
+    clap_id id;
+    Steinberg::Vst::ParamID vst3id;
+  };
+  Entry _entries[capacity] = {};
+  uint32_t _count = 0;
+};
+
+class ParameterTablePublisher
+{
+ public:
+  ParameterTablePublisher() = default;
+  ParameterTablePublisher(const ParameterTablePublisher&) = delete;
+  ParameterTablePublisher& operator=(const ParameterTablePublisher&) = delete;
+  ~ParameterTablePublisher();
+
+  // [main-thread] replaces the current table, the previous one is retired
+  void publish(std::unique_ptr<ParameterTable> table);
+
+  // [main-thread] deletes retired tables which are not in use anymore
+  void reclaim();
+
+  // [audio-thread]
+  const ParameterTable* acquire()
+  {
+    ParameterTable* table;
+    do
+    {
+      table = _current.load();
+      _hazard.store(table);
+    } while (table != _current.load());
+    return table;
+  }
+  void release()
+  {
+    _hazard.store(nullptr);
+  }
+
+ private:
+  std::atomic<ParameterTable*> _current{nullptr};
+  std::atomic<ParameterTable*> _hazard{nullptr};
+  std::vector<ParameterTable*> _retired;
+};
+
+// acquires the current table for the lifetime of a process() or flush() call
+class ParameterTableReader
+{
+ public:
+  explicit ParameterTableReader(ParameterTablePublisher* publisher) : _publisher(publisher)
+  {
+    _table = _publisher ? _publisher->acquire() : nullptr;
+  }
+  ~ParameterTableReader()
+  {
+    if (_publisher) _publisher->release();
+  }
+  ParameterTableReader(const ParameterTableReader&) = delete;
+  ParameterTableReader& operator=(const ParameterTableReader&) = delete;
+
+  const ParameterTable* get() const
+  {
+    return _table;
+  }
+
+ private:
+  ParameterTablePublisher* _publisher;
+  const ParameterTable* _table;
+};
+
+}  // namespace Clap
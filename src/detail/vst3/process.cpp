@@ -5,6 +5,8 @@
 #include <pluginterfaces/vst/ivstcomponent.h>
 
 #include "parameter.h"
+#include "../shared/sampleconvert.h"
+#include "../shared/constantbuffer.h"
 #include <algorithm>
 
 #include <cmath>
@@ -14,21 +16,35 @@ namespace Clap
 {
 using namespace Steinberg;
 
+ProcessAdapter::~ProcessAdapter()
+{
+  delete[] _input_ports;
+  delete[] _output_ports;
+  delete[] _silent_input;
+  delete[] _silent_output;
+}
+
 void ProcessAdapter::setupProcessing(const clap_plugin_t* plugin, const clap_plugin_params_t* ext_params,
+                                     const clap_plugin_audio_ports_t* ext_audioports,
+                                     const clap_plugin_tail_t* ext_tail,
                                      Vst::BusList& audioinputs, Vst::BusList& audiooutputs,
                                      uint32_t numSamples, size_t /*numEventInputs*/,
                                      size_t /*numEventOutputs*/,
-                                     Steinberg::Vst::ParameterContainer& params,
+                                     ParameterTablePublisher* parameterTables,
+                                     OpenGestures* gestures,
                                      Steinberg::Vst::IComponentHandler* componenthandler,
                                      IAutomation* automation, bool enablePolyPressure,
-                                     bool supportsTuningNoteExpression)
+                                     bool supportsTuningNoteExpression, bool use64bitSamples)
 {
   _plugin = plugin;
   _ext_params = ext_params;
+  _ext_tail = ext_tail;
+  _processStatus.reset();
   _audioinputs = &audioinputs;
   _audiooutputs = &audiooutputs;
 
-  parameters = &params;
+  _parameterTables = parameterTables;
+  _gestures = gestures;
   _componentHandler = componenthandler;
   _automation = automation;
 
@@ -98,6 +114,11 @@ void ProcessAdapter::setupProcessing(const clap_plugin_t* plugin, const clap_plu
     _processData.audio_outputs = nullptr;
   }
 
+  if (use64bitSamples)
+  {
+    setupBuffers64(ext_audioports, numSamples);
+  }
+
   _processData.in_events = &_in_events;
   _processData.out_events = &_out_events;
 
@@ -110,21 +131,346 @@ void ProcessAdapter::setupProcessing(const clap_plugin_t* plugin, const clap_plu
   _out_events.ctx = this;
   _out_events.try_push = output_events_try_push;
 
-  _events.clear();
-  _events.reserve(8192);
-  _eventindices.clear();
-  _eventindices.reserve(_events.capacity());
-
   _out_events.ctx = this;
 
-  _gesturedParameters.reserve(8192);
+  uint32_t numParams = 0;
+  {
+    ParameterTableReader table(_parameterTables);
+    numParams = table.get() ? table.get()->size() : 0;
+  }
+
+  // room for a few automation points of every parameter and a dense stream of host events
+  auto numEvents = std::max<size_t>(8192, (size_t)numParams * 4 + numSamples);
+  _events.reserve(numEvents, numEvents * sizeof(clap_event_param_value_t));
+  // the arena holds more than numEvents, there is headroom for events ending notes
+  _eventSorter.reserve(_events.capacity());
 
-  _activeNotes.reserve(32);
+  _activeNotes.clear();
 
   _supportsPolyPressure = enablePolyPressure;
   _supportsTuningNoteExpression = supportsTuningNoteExpression;
 }
 
+void ProcessAdapter::setupFlushing(const clap_plugin_t* plugin, const clap_plugin_params_t* ext_params,
+                                   ParameterTablePublisher* parameterTables,
+                                   OpenGestures* gestures,
+                                   Steinberg::Vst::IComponentHandler* componenthandler,
+                                   IAutomation* automation)
+{
+  _plugin = plugin;
+  _ext_params = ext_params;
+  _parameterTables = parameterTables;
+  _gestures = gestures;
+  _componentHandler = componenthandler;
+  // gestures begun in a flush may end in process() and vice versa, both report them
+  _automation = automation;
+
+  // no audio and no input events, flush() only collects the output of the plugin
+  _processData.audio_inputs_count = 0;
+  _processData.audio_inputs = nullptr;
+  _processData.audio_outputs_count = 0;
+  _processData.audio_outputs = nullptr;
+
+  _in_events.ctx = this;
+  _in_events.size = input_events_size;
+  _in_events.get = input_events_get;
+
+  _out_events.ctx = this;
+  _out_events.try_push = output_events_try_push;
+}
+
+void ProcessAdapter::setupBuffers64(const clap_plugin_audio_ports_t* ext_audioports,
+                                    uint32_t numSamples)
+{
+  // ports flagged with CLAP_AUDIO_PORT_SUPPORTS_64BITS get the host buffers directly,
+  // all others are converted from/to 32 bit into buffers allocated here.
+  auto numInputs = _processData.audio_inputs_count;
+  auto numOutputs = _processData.audio_outputs_count;
+
+  _input_port_64bit.assign(numInputs, false);
+  _output_port_64bit.assign(numOutputs, false);
+  _input_conversion_offset.assign(numInputs, 0);
+  _output_conversion_offset.assign(numOutputs, 0);
+
+  size_t numChannels = 0;
+  for (auto i = 0U; i < numInputs; ++i)
+  {
+    clap_audio_port_info_t info;
+    if (ext_audioports && ext_audioports->get(_plugin, i, true, &info) &&
+        (info.flags & CLAP_AUDIO_PORT_SUPPORTS_64BITS))
+    {
+      _input_port_64bit[i] = true;
+    }
+    else
+    {
+      _input_conversion_offset[i] = numChannels;
+      numChannels += _input_ports[i].channel_count;
+    }
+  }
+  for (auto i = 0U; i < numOutputs; ++i)
+  {
+    clap_audio_port_info_t info;
+    if (ext_audioports && ext_audioports->get(_plugin, i, false, &info) &&
+        (info.flags & CLAP_AUDIO_PORT_SUPPORTS_64BITS))
+    {
+      _output_port_64bit[i] = true;
+    }
+    else
+    {
+      _output_conversion_offset[i] = numChannels;
+      numChannels += _output_ports[i].channel_count;
+    }
+  }
+
+  _conversion_frames = numSamples;
+  _conversion_buffer.assign(numChannels * numSamples, 0.f);
+  _conversion_channels.resize(numChannels);
+  for (size_t c = 0; c < numChannels; ++c)
+  {
+    _conversion_channels[c] = _conversion_buffer.data() + c * numSamples;
+  }
+}
+
+bool ProcessAdapter::connectBuffers64()
+{
+  auto numInputs = _processData.audio_inputs_count;
+  auto numOutputs = _processData.audio_outputs_count;
+
+  // the host did not announce 64 bit processing in setupProcessing()
+  if (_input_port_64bit.size() != numInputs || _output_port_64bit.size() != numOutputs)
+  {
+    return false;
+  }
+
+  auto numSamples = (uint32_t)_vstdata->numSamples;
+
+  for (auto i = 0U; i < numInputs; ++i)
+  {
+    auto& bus = _vstdata->inputs[i];
+    auto& port = _input_ports[i];
+    if (bus.numChannels != (Steinberg::int32)port.channel_count)
+    {
+      return false;
+    }
+    if (_input_port_64bit[i])
+    {
+      port.data64 = bus.channelBuffers64;
+      port.data32 = nullptr;
+    }
+    else
+    {
+      if (numSamples > _conversion_frames)
+      {
+        return false;
+      }
+      auto channels = _conversion_channels.data() + _input_conversion_offset[i];
+      for (auto c = 0U; c < port.channel_count; ++c)
+      {
+        ClapWrapper::detail::shared::convertSamples(bus.channelBuffers64[c], channels[c], numSamples);
+      }
+      port.data32 = channels;
+      port.data64 = nullptr;
+    }
+  }
+
+  for (auto i = 0U; i < numOutputs; ++i)
+  {
+    auto& bus = _vstdata->outputs[i];
+    auto& port = _output_ports[i];
+    if (bus.numChannels != (Steinberg::int32)port.channel_count)
+    {
+      return false;
+    }
+    if (_output_port_64bit[i])
+    {
+      port.data64 = bus.channelBuffers64;
+      port.data32 = nullptr;
+    }
+    else
+    {
+      if (numSamples > _conversion_frames)
+      {
+        return false;
+      }
+      port.data32 = _conversion_channels.data() + _output_conversion_offset[i];
+      port.data64 = nullptr;
+    }
+  }
+  return true;
+}
+
+void ProcessAdapter::convertOutputs64()
+{
+  auto numSamples = (uint32_t)_vstdata->numSamples;
+  for (auto i = 0U; i < _processData.audio_outputs_count; ++i)
+  {
+    if (!_output_port_64bit[i])
+    {
+      auto& bus = _vstdata->outputs[i];
+      auto& port = _output_ports[i];
+      for (auto c = 0U; c < port.channel_count; ++c)
+      {
+        ClapWrapper::detail::shared::convertSamples(port.data32[c], bus.channelBuffers64[c], numSamples);
+      }
+    }
+  }
+}
+
+static bool isChannelConstant(const clap_audio_buffer_t& port, uint32_t channel, uint32_t numSamples)
+{
+  if (port.data32)
+  {
+    return ClapWrapper::detail::shared::isConstantBuffer(port.data32[channel], numSamples);
+  }
+  if (port.data64)
+  {
+    return ClapWrapper::detail::shared::isConstantBuffer(port.data64[channel], numSamples);
+  }
+  return false;
+}
+
+static bool isChannelStartingWithZero(const clap_audio_buffer_t& port, uint32_t channel)
+{
+  if (port.data32)
+  {
+    return port.data32[channel][0] == 0.f;
+  }
+  if (port.data64)
+  {
+    return port.data64[channel][0] == 0.;
+  }
+  return false;
+}
+
+void ProcessAdapter::updateInputConstantMasks()
+{
+  auto numSamples = (uint32_t)_vstdata->numSamples;
+  for (auto i = 0U; i < _processData.audio_inputs_count; ++i)
+  {
+    auto& port = _input_ports[i];
+    // a silent channel is constant, so the host flags can be taken over directly
+    uint64_t mask = _vstdata->inputs[i].silenceFlags;
+    if (port.channel_count < 64)
+    {
+      mask &= (1ULL << port.channel_count) - 1;
+    }
+#if CLAP_WRAPPER_DETECT_CONSTANT_BUFFERS
+    // hosts not providing any silence information at all are checked by the wrapper
+    if (mask == 0)
+    {
+      auto numChannels = std::min(port.channel_count, 64U);
+      for (auto c = 0U; c < numChannels; ++c)
+      {
+        if (isChannelConstant(port, c, numSamples))
+        {
+          mask |= 1ULL << c;
+        }
+      }
+    }
+#else
+    (void)numSamples;
+#endif
+    port.constant_mask = mask;
+  }
+
+  // the plugin reports constant outputs back via the mask
+  for (auto i = 0U; i < _processData.audio_outputs_count; ++i)
+  {
+    _output_ports[i].constant_mask = 0;
+  }
+}
+
+void ProcessAdapter::updateOutputSilenceFlags()
+{
+  auto numSamples = (uint32_t)_vstdata->numSamples;
+  for (auto i = 0U; i < _processData.audio_outputs_count; ++i)
+  {
+    auto& port = _output_ports[i];
+    auto numChannels = std::min(port.channel_count, 64U);
+    uint64_t silence = 0;
+    for (auto c = 0U; c < numChannels; ++c)
+    {
+      const uint64_t bit = 1ULL << c;
+      bool constant = (port.constant_mask & bit) != 0;
+#if CLAP_WRAPPER_DETECT_CONSTANT_BUFFERS
+      if (!constant)
+      {
+        constant = isChannelConstant(port, c, numSamples);
+      }
+#else
+      (void)numSamples;
+#endif
+      // VST3 only knows about silence, a constant DC offset must not be flagged
+      if (constant && isChannelStartingWithZero(port, c))
+      {
+        silence |= bit;
+      }
+    }
+    _vstdata->outputs[i].silenceFlags = silence;
+  }
+}
+
+bool ProcessAdapter::areInputsQuiet() const
+{
+  for (auto i = 0U; i < _processData.audio_inputs_count; ++i)
+  {
+    auto& port = _input_ports[i];
+    for (auto c = 0U; c < port.channel_count; ++c)
+    {
+      if (c >= 64 || !(port.constant_mask & (1ULL << c)) || !isChannelStartingWithZero(port, c))
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool ProcessAdapter::areOutputsQuiet() const
+{
+  // only called when the plugin asks for it, so the buffers are always checked here
+  auto numSamples = (uint32_t)_vstdata->numSamples;
+  for (auto i = 0U; i < _processData.audio_outputs_count; ++i)
+  {
+    auto& port = _output_ports[i];
+    for (auto c = 0U; c < port.channel_count; ++c)
+    {
+      if (!isChannelStartingWithZero(port, c) || !isChannelConstant(port, c, numSamples))
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void ProcessAdapter::writeSilence()
+{
+  auto numSamples = (uint32_t)_vstdata->numSamples;
+  const bool is64bit = (_vstdata->symbolicSampleSize == Vst::kSample64);
+  for (auto i = 0U; i < _processData.audio_outputs_count; ++i)
+  {
+    auto& bus = _vstdata->outputs[i];
+    for (auto c = 0; c < bus.numChannels; ++c)
+    {
+      if (is64bit)
+      {
+        std::fill_n(bus.channelBuffers64[c], numSamples, 0.);
+      }
+      else
+      {
+        std::fill_n(bus.channelBuffers32[c], numSamples, 0.f);
+      }
+    }
+    bus.silenceFlags = (bus.numChannels < 64) ? ((1ULL << bus.numChannels) - 1) : ~0ULL;
+  }
+}
+
+void ProcessAdapter::wakeup()
+{
+  _processStatus.reset();
+}
+
 void ProcessAdapter::activateAudioBus(Steinberg::Vst::BusDirection dir, int32 index, TBool state)
 {
   /*
@@ -162,11 +508,15 @@ void ProcessAdapter::flush()
   // minimal processing if _ext_params is existent
   if (_ext_params)
   {
+    ParameterTableReader table(_parameterTables);
+    _parameterTable = table.get();
+
     _events.clear();
-    _eventindices.clear();
 
     // sortEventIndices(); call only if there would be any input event
     _ext_params->flush(_plugin, _processData.in_events, _processData.out_events);
+
+    _parameterTable = nullptr;
   }
 }
 
@@ -176,6 +526,10 @@ void ProcessAdapter::process(Steinberg::Vst::ProcessData& data)
   // remember the ProcessData pointer during process
   _vstdata = &data;
 
+  // the parameter table must not change while the block is processed
+  ParameterTableReader table(_parameterTables);
+  _parameterTable = table.get();
+
   /// convert timing
   _transport.header = {sizeof(_transport), 0, CLAP_CORE_EVENT_SPACE_ID, CLAP_EVENT_TRANSPORT, 0};
 
@@ -273,111 +627,33 @@ void ProcessAdapter::process(Steinberg::Vst::ProcessData& data)
 
   // always clear
   _events.clear();
-  _eventindices.clear();
 
   processInputEvents(_vstdata->inputEvents);
 
-  if (_vstdata->inputParameterChanges)
+  if (_vstdata->inputParameterChanges && _parameterTable)
   {
     auto numPevent = _vstdata->inputParameterChanges->getParameterCount();
     for (decltype(numPevent) i = 0; i < numPevent; ++i)
     {
       auto k = _vstdata->inputParameterChanges->getParameterData(i);
 
-      // get the Vst3Parameter
+      // get the parameter slot
       auto paramid = k->getParameterId();
 
-      // if a parameter is currently edited by a user, we are not allowed to send this back to the CLAP.
-      // this is a fundamental difference between VST3 and CLAP
-      if (std::find(_gesturedParameters.begin(), _gesturedParameters.end(), paramid) !=
-          _gesturedParameters.end())
+      auto index = _parameterTable->indexOf(paramid);
+      if (index == ClapWrapper::detail::shared::ParamIndexMap::npos)
       {
         continue;
       }
 
-      auto param = (Vst3Parameter*)parameters->getParameter(paramid);
-      if (param)
+      // if a parameter is currently edited by a user, we are not allowed to send this back to the CLAP.
+      // this is a fundamental difference between VST3 and CLAP
+      if (_gestures && _gestures->isActive((*_parameterTable)[index].id))
       {
-        if (param->isMidi)
-        {
-          auto nums = k->getPointCount();
-
-          Vst::ParamValue value;
-          int32 offset;
-          if (k->getPoint(nums - 1, offset, value) == kResultOk)
-          {
-            // create MIDI event
-            clap_multi_event_t n;
-            n.param.header.type = CLAP_EVENT_MIDI;
-            n.param.header.flags = 0;
-            n.param.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
-            n.param.header.time = offset;
-            n.param.header.size = sizeof(clap_event_midi_t);
-            n.midi.port_index = 0;
-
-            switch (param->controller)
-            {
-              case Vst::ControllerNumbers::kAfterTouch:
-                n.midi.data[0] = 0xD0 | param->channel;
-                n.midi.data[1] = param->asClapValue(value);
-                n.midi.data[2] = 0;
-                break;
-              case Vst::ControllerNumbers::kPitchBend:
-              {
-                auto val = (uint16_t)param->asClapValue(value);
-                n.midi.data[0] = 0xE0 | param->channel;  // $Ec
-                n.midi.data[1] = (val & 0x7F);           // LSB
-                n.midi.data[2] = (val >> 7) & 0x7F;      // MSB
-              }
-              break;
-              case Vst::ControllerNumbers::kCtrlProgramChange:
-              {
-                auto val = (uint16_t)param->asClapValue(value);
-                n.midi.data[0] = 0xC0 | param->channel;  // $Cc
-                n.midi.data[1] = (val & 0x7F);           // only one byte
-                n.midi.data[2] = 0;
-              }
-              break;
-              default:
-                n.midi.data[0] = 0xB0 | param->channel;
-                n.midi.data[1] = param->controller;
-                n.midi.data[2] = param->asClapValue(value);
-                break;
-            }
-
-            _eventindices.push_back(_events.size());
-            _events.push_back(n);
-          }
-        }
-        else
-        {
-          auto nums = k->getPointCount();
-
-          Vst::ParamValue value;
-          int32 offset;
-          if (k->getPoint(nums - 1, offset, value) == kResultOk)
-          {
-            clap_multi_event_t n;
-            n.param.header.type = CLAP_EVENT_PARAM_VALUE;
-            n.param.header.flags = 0;
-            n.param.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
-            n.param.header.time = offset;
-            n.param.header.size = sizeof(clap_event_param_value);
-            n.param.param_id = param->id;
-            n.param.cookie = param->cookie;
-
-            // nothing note specific
-            n.param.note_id = -1;  // always global
-            n.param.port_index = -1;
-            n.param.channel = -1;
-            n.param.key = -1;
-
-            n.param.value = param->asClapValue(value);
-            _eventindices.push_back(_events.size());
-            _events.push_back(n);
-          }
-        }
+        continue;
       }
+
+      processParameterQueue(k, (*_parameterTable)[index]);
     }
   }
 
@@ -387,34 +663,74 @@ void ProcessAdapter::process(Steinberg::Vst::ProcessData& data)
 
   if (_vstdata->numSamples > 0)
   {
+    const bool is64bit = (_vstdata->symbolicSampleSize == Vst::kSample64);
+
     // setting the buffers
-    auto inbusses = _audioinputs->size();
-    for (auto i = 0U; i < inbusses; ++i)
+    if (is64bit)
+    {
+      doProcess = connectBuffers64();
+    }
+    else
     {
-      if (_vstdata->inputs[i].numChannels == (Steinberg::int32)_input_ports[i].channel_count)
+      auto inbusses = _audioinputs->size();
+      for (auto i = 0U; i < inbusses; ++i)
       {
-        _input_ports[i].data32 = _vstdata->inputs[i].channelBuffers32;
+        if (_vstdata->inputs[i].numChannels == (Steinberg::int32)_input_ports[i].channel_count)
+        {
+          _input_ports[i].data32 = _vstdata->inputs[i].channelBuffers32;
+          _input_ports[i].data64 = nullptr;
+        }
+        else
+        {
+          doProcess = false;
+        }
       }
-      else
+
+      auto outbusses = _audiooutputs->size();
+      for (auto i = 0U; i < outbusses; ++i)
       {
-        doProcess = false;
+        if (_vstdata->outputs[i].numChannels == (Steinberg::int32)_output_ports[i].channel_count)
+        {
+          _output_ports[i].data32 = _vstdata->outputs[i].channelBuffers32;
+          _output_ports[i].data64 = nullptr;
+        }
+        else
+        {
+          doProcess = false;
+        }
       }
     }
-
-    auto outbusses = _audiooutputs->size();
-    for (auto i = 0U; i < outbusses; ++i)
+    if (doProcess)
     {
-      if (_vstdata->outputs[i].numChannels == (Steinberg::int32)_output_ports[i].channel_count)
+      updateInputConstantMasks();
+      const bool inputQuiet = areInputsQuiet();
+      const bool callPlugin = _processStatus.shouldProcess(!_events.empty(), inputQuiet);
+      markPhase(ClapWrapper::detail::shared::ProcessPhase::events);
+      if (callPlugin)
       {
-        _output_ports[i].data32 = _vstdata->outputs[i].channelBuffers32;
+        auto status = _plugin->process(_plugin, &_processData);
+        markPhase(ClapWrapper::detail::shared::ProcessPhase::plugin);
+        if (status == CLAP_PROCESS_ERROR)
+        {
+          // the output of a failed process call must be discarded
+          writeSilence();
+        }
+        else
+        {
+          if (is64bit)
+          {
+            convertOutputs64();
+          }
+          updateOutputSilenceFlags();
+        }
+        _processStatus.update(status, _processData.frames_count, inputQuiet, _plugin, _ext_tail,
+                              [this] { return areOutputsQuiet(); });
       }
       else
       {
-        doProcess = false;
+        writeSilence();
       }
     }
-    if (doProcess)
-      _plugin->process(_plugin, &_processData);
     else
     {
       if (_ext_params)
@@ -436,7 +752,9 @@ void ProcessAdapter::process(Steinberg::Vst::ProcessData& data)
   }
 
   processOutputParams(data);
+  markPhase(ClapWrapper::detail::shared::ProcessPhase::output);
 
+  _parameterTable = nullptr;
   _vstdata = nullptr;
 }
 
@@ -452,19 +770,12 @@ uint32_t ProcessAdapter::input_events_size(const struct clap_input_events* list)
 }
 
 // returns the pointer to an event in the list. The index accessed is not the position in the event list itself
-// since all events indices were sorted by timestamp
+// since the event order was sorted by timestamp
 const clap_event_header_t* ProcessAdapter::input_events_get(const struct clap_input_events* list,
                                                             uint32_t index)
 {
   auto self = static_cast<ProcessAdapter*>(list->ctx);
-  if (self->_events.size() > index)
-  {
-    // we can safely return the note.header also for other event types
-    // since they are at the same memory address
-    auto realindex = self->_eventindices[index];
-    return &(self->_events[realindex].header);
-  }
-  return nullptr;
+  return self->_events.get(index);
 }
 
 bool ProcessAdapter::output_events_try_push(const struct clap_output_events* list,
@@ -476,21 +787,137 @@ bool ProcessAdapter::output_events_try_push(const struct clap_output_events* lis
   return self->enqueueOutputEvent(event);
 }
 
+void ProcessAdapter::processParameterQueue(Steinberg::Vst::IParamValueQueue* queue,
+                                           const ParameterSlot& param)
+{
+  // every point of the queue becomes its own time stamped event, so the CLAP receives the
+  // automation in the resolution the host provides. Points closer to the last passed value
+  // than the tolerance of the parameter are thinned out, the last point is always passed on.
+  auto nums = queue->getPointCount();
+  if (nums <= 0)
+  {
+    return;
+  }
+
+  const auto lastpoint = nums - 1;
+  bool emitted = false;
+  Vst::ParamValue lastvalue = 0.;
+
+  for (decltype(nums) i = 0; i < nums; ++i)
+  {
+    Vst::ParamValue value;
+    int32 offset;
+    if (queue->getPoint(i, offset, value) != kResultOk)
+    {
+      continue;
+    }
+
+    if (emitted && std::abs(value - lastvalue) <= param.automation_tolerance)
+    {
+      if (i != lastpoint || value == lastvalue)
+      {
+        continue;
+      }
+    }
+
+    // intermediate points are given up first when the arena runs full, the last point
+    // keeps the room it needs
+    if (i != lastpoint && _events.remaining(sizeof(clap_multi_event_t)) <= 1)
+    {
+      _events.countOverflow();
+      continue;
+    }
+
+    if (param.isMidi)
+    {
+      addMIDIControllerEvent(param, offset, value);
+    }
+    else
+    {
+      addParameterValueEvent(param, offset, value);
+    }
+    emitted = true;
+    lastvalue = value;
+  }
+}
+
+void ProcessAdapter::addParameterValueEvent(const ParameterSlot& param, Steinberg::int32 offset,
+                                            Steinberg::Vst::ParamValue value)
+{
+  clap_multi_event_t n;
+  n.param.header.type = CLAP_EVENT_PARAM_VALUE;
+  n.param.header.flags = 0;
+  n.param.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+  n.param.header.time = offset;
+  n.param.header.size = sizeof(clap_event_param_value);
+  n.param.param_id = param.id;
+  n.param.cookie = param.cookie;
+
+  // nothing note specific
+  n.param.note_id = -1;  // always global
+  n.param.port_index = -1;
+  n.param.channel = -1;
+  n.param.key = -1;
+
+  n.param.value = param.asClapValue(value);
+  _events.push(&n.header);
+}
+
+void ProcessAdapter::addMIDIControllerEvent(const ParameterSlot& param, Steinberg::int32 offset,
+                                            Steinberg::Vst::ParamValue value)
+{
+  // create MIDI event
+  clap_multi_event_t n;
+  n.param.header.type = CLAP_EVENT_MIDI;
+  n.param.header.flags = 0;
+  n.param.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+  n.param.header.time = offset;
+  n.param.header.size = sizeof(clap_event_midi_t);
+  n.midi.port_index = 0;
+
+  switch (param.controller)
+  {
+    case Vst::ControllerNumbers::kAfterTouch:
+      n.midi.data[0] = 0xD0 | param.channel;
+      n.midi.data[1] = param.asClapValue(value);
+      n.midi.data[2] = 0;
+      break;
+    case Vst::ControllerNumbers::kPitchBend:
+    {
+      auto val = (uint16_t)param.asClapValue(value);
+      n.midi.data[0] = 0xE0 | param.channel;  // $Ec
+      n.midi.data[1] = (val & 0x7F);           // LSB
+      n.midi.data[2] = (val >> 7) & 0x7F;      // MSB
+    }
+    break;
+    case Vst::ControllerNumbers::kCtrlProgramChange:
+    {
+      auto val = (uint16_t)param.asClapValue(value);
+      n.midi.data[0] = 0xC0 | param.channel;  // $Cc
+      n.midi.data[1] = (val & 0x7F);           // only one byte
+      n.midi.data[2] = 0;
+    }
+    break;
+    default:
+      n.midi.data[0] = 0xB0 | param.channel;
+      n.midi.data[1] = param.controller;
+      n.midi.data[2] = param.asClapValue(value);
+      break;
+  }
+
+  _events.push(&n.header);
+}
+
 void ProcessAdapter::sortEventIndices()
 {
   // just sorting the index
   // an item must be sorted to front of
   // if the timestamp if event[a] is earlier than
   // the timestamp of event[b].
-  // if they have the same timestamp, the index must be preserved
+  // if they have the same timestamp, the index must be preserved.
+  // the events are added in ascending runs, so these are merged rather than sorted.
 
-  std::sort(_eventindices.begin(), _eventindices.end(),
-            [&](size_t const& a, size_t const& b)
-            {
-              auto t1 = _events[a].header.time;
-              auto t2 = _events[b].header.time;
-              return (t1 == t2) ? (a < b) : (t1 < t2);
-            });
+  _eventSorter.sort(_events.order(), [this](uint32_t offset) { return _events.at(offset)->time; });
 }
 
 void ProcessAdapter::processInputEvents(Steinberg::Vst::IEventList* eventlist)
@@ -516,9 +943,10 @@ void ProcessAdapter::processInputEvents(Steinberg::Vst::IEventList* eventlist)
           n.note.port_index = 0;
           n.note.velocity = vstevent.noteOn.velocity;
           n.note.key = vstevent.noteOn.pitch;
-          _eventindices.push_back(_events.size());
-          _events.push_back(n);
-          addToActiveNotes(&n.note);
+          if (_events.push(&n.header))
+          {
+            addToActiveNotes(&n.note);
+          }
 
           // CLAP doesn't support note-on retuning but does support note expressions so
           // convert but only if your target clap supports note expressions
@@ -541,8 +969,7 @@ void ProcessAdapter::processInputEvents(Steinberg::Vst::IEventList* eventlist)
             // VST3 Tuning is float in cents. We are in semitones. So
             n.noteexpression.value = vstevent.noteOn.tuning * 0.01;
             n.noteexpression.expression_id = CLAP_NOTE_EXPRESSION_TUNING;
-            _eventindices.push_back(_events.size());
-            _events.push_back(n);
+            _events.push(&n.header);
           }
         }
         if (vstevent.type == Vst::Event::kNoteOffEvent)
@@ -558,8 +985,7 @@ void ProcessAdapter::processInputEvents(Steinberg::Vst::IEventList* eventlist)
           n.note.port_index = 0;
           n.note.velocity = vstevent.noteOff.velocity;
           n.note.key = vstevent.noteOff.pitch;
-          _eventindices.push_back(_events.size());
-          _events.push_back(n);
+          _events.push(&n.header);
         }
         if (vstevent.type == Vst::Event::kDataEvent)
         {
@@ -574,8 +1000,7 @@ void ProcessAdapter::processInputEvents(Steinberg::Vst::IEventList* eventlist)
             n.sysex.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
             n.sysex.header.time = vstevent.sampleOffset;
             n.sysex.header.size = sizeof(n.sysex);
-            _eventindices.push_back(_events.size());
-            _events.push_back(n);
+            _events.push(&n.header);
           }
           else
           {
@@ -592,19 +1017,16 @@ void ProcessAdapter::processInputEvents(Steinberg::Vst::IEventList* eventlist)
           n.noteexpression.header.time = vstevent.sampleOffset;
           n.noteexpression.header.size = sizeof(clap_event_note_expression);
           n.noteexpression.note_id = vstevent.polyPressure.noteId;
-          for (auto& i : _activeNotes)
+          if (auto note = findActiveNote(vstevent.polyPressure.noteId, vstevent.polyPressure.channel,
+                                         vstevent.polyPressure.pitch))
           {
-            if (i.used && i.note_id == vstevent.polyPressure.noteId)
-            {
-              n.noteexpression.expression_id = CLAP_NOTE_EXPRESSION_PRESSURE;
-              n.noteexpression.port_index = i.port_index;
-              n.noteexpression.key = i.key;  // should be the same as vstevent.polyPressure.pitch
-              n.noteexpression.channel = i.channel;
-              n.noteexpression.value = vstevent.polyPressure.pressure;
-            }
+            n.noteexpression.expression_id = CLAP_NOTE_EXPRESSION_PRESSURE;
+            n.noteexpression.port_index = note->port_index;
+            n.noteexpression.key = note->key;  // should be the same as vstevent.polyPressure.pitch
+            n.noteexpression.channel = note->channel;
+            n.noteexpression.value = vstevent.polyPressure.pressure;
+            _events.push(&n.header);
           }
-          _eventindices.push_back(_events.size());
-          _events.push_back(n);
         }
         else if (vstevent.type == Vst::Event::kPolyPressureEvent)
         {
@@ -617,22 +1039,13 @@ void ProcessAdapter::processInputEvents(Steinberg::Vst::IEventList* eventlist)
           n.param.header.size = sizeof(clap_event_midi_t);
           n.midi.port_index = 0;
           n.midi.data[0] = 0xA0 + vstevent.polyPressure.channel;
-          int key{-1};
-          for (auto& i : _activeNotes)
-          {
-            if (i.used && i.note_id == vstevent.polyPressure.noteId)
-            {
-              key = i.key;
-              break;
-            }
-          }
-          if (key >= 0)
+          if (auto note = findActiveNote(vstevent.polyPressure.noteId, vstevent.polyPressure.channel,
+                                         vstevent.polyPressure.pitch))
           {
-            n.midi.data[1] = key;
+            n.midi.data[1] = note->key;
             n.midi.data[2] = vstevent.polyPressure.pressure * 127.0;
 
-            _eventindices.push_back(_events.size());
-            _events.push_back(n);
+            _events.push(&n.header);
           }
         }
         if (vstevent.type == Vst::Event::kNoteExpressionValueEvent)
@@ -645,41 +1058,42 @@ void ProcessAdapter::processInputEvents(Steinberg::Vst::IEventList* eventlist)
           n.noteexpression.header.time = vstevent.sampleOffset;
           n.noteexpression.header.size = sizeof(clap_event_note_expression);
           n.noteexpression.note_id = vstevent.noteExpressionValue.noteId;
-          for (auto& i : _activeNotes)
+          if (auto note = _activeNotes.findByNoteId(vstevent.noteExpressionValue.noteId))
           {
-            if (i.used && i.note_id == vstevent.noteExpressionValue.noteId)
+            n.noteexpression.port_index = note->port_index;
+            n.noteexpression.key = note->key;
+            n.noteexpression.channel = note->channel;
+            n.noteexpression.value = vstevent.noteExpressionValue.value;
+            bool known = true;
+            switch (vstevent.noteExpressionValue.typeId)
             {
-              n.noteexpression.port_index = i.port_index;
-              n.noteexpression.key = i.key;
-              n.noteexpression.channel = i.channel;
-              n.noteexpression.value = vstevent.noteExpressionValue.value;
-              switch (vstevent.noteExpressionValue.typeId)
-              {
-                case Vst::NoteExpressionTypeIDs::kVolumeTypeID:
-                  n.noteexpression.expression_id = CLAP_NOTE_EXPRESSION_VOLUME;
-                  break;
-                case Vst::NoteExpressionTypeIDs::kPanTypeID:
-                  n.noteexpression.expression_id = CLAP_NOTE_EXPRESSION_PAN;
-                  break;
-                case Vst::NoteExpressionTypeIDs::kTuningTypeID:
-                  // VST3 has a 0...1 range; clap has a -120 ... 120 range
-                  n.noteexpression.value = (n.noteexpression.value - 0.5) * 2 * 120;
-                  n.noteexpression.expression_id = CLAP_NOTE_EXPRESSION_TUNING;
-                  break;
-                case Vst::NoteExpressionTypeIDs::kVibratoTypeID:
-                  n.noteexpression.expression_id = CLAP_NOTE_EXPRESSION_VIBRATO;
-                  break;
-                case Vst::NoteExpressionTypeIDs::kExpressionTypeID:
-                  n.noteexpression.expression_id = CLAP_NOTE_EXPRESSION_EXPRESSION;
-                  break;
-                case Vst::NoteExpressionTypeIDs::kBrightnessTypeID:
-                  n.noteexpression.expression_id = CLAP_NOTE_EXPRESSION_BRIGHTNESS;
-                  break;
-                default:
-                  continue;
-              }
-              _eventindices.push_back(_events.size());
-              _events.push_back(n);
+              case Vst::NoteExpressionTypeIDs::kVolumeTypeID:
+                n.noteexpression.expression_id = CLAP_NOTE_EXPRESSION_VOLUME;
+                break;
+              case Vst::NoteExpressionTypeIDs::kPanTypeID:
+                n.noteexpression.expression_id = CLAP_NOTE_EXPRESSION_PAN;
+                break;
+              case Vst::NoteExpressionTypeIDs::kTuningTypeID:
+                // VST3 has a 0...1 range; clap has a -120 ... 120 range
+                n.noteexpression.value = (n.noteexpression.value - 0.5) * 2 * 120;
+                n.noteexpression.expression_id = CLAP_NOTE_EXPRESSION_TUNING;
+                break;
+              case Vst::NoteExpressionTypeIDs::kVibratoTypeID:
+                n.noteexpression.expression_id = CLAP_NOTE_EXPRESSION_VIBRATO;
+                break;
+              case Vst::NoteExpressionTypeIDs::kExpressionTypeID:
+                n.noteexpression.expression_id = CLAP_NOTE_EXPRESSION_EXPRESSION;
+                break;
+              case Vst::NoteExpressionTypeIDs::kBrightnessTypeID:
+                n.noteexpression.expression_id = CLAP_NOTE_EXPRESSION_BRIGHTNESS;
+                break;
+              default:
+                known = false;
+                break;
+            }
+            if (known)
+            {
+              _events.push(&n.header);
             }
           }
         }
@@ -739,15 +1153,18 @@ bool ProcessAdapter::enqueueOutputEvent(const clap_event_header_t* event)
     case CLAP_EVENT_PARAM_VALUE:
     {
       auto ev = (clap_event_param_value*)event;
-      auto param = (Vst3Parameter*)this->parameters->getParameter(ev->param_id & 0x7FFFFFFF);
-      if (param)
+      auto slotIndex = findParameterSlot(ev->param_id);
+      if (slotIndex != ClapWrapper::detail::shared::ParamIndexMap::npos)
       {
-        auto param_id = param->getInfo().id;
+        auto& param = (*_parameterTable)[slotIndex];
+        auto param_id = param.vst3id;
+
+        // a changed parameter always means a changed state
+        if (_automation) _automation->onParameterOutput(ev->param_id);
 
         // if the parameter is marked as being edited in the UI, pass the value
         // to the queue so it can be given to the IComponentHandler
-        if (std::find(_gesturedParameters.begin(), _gesturedParameters.end(), param_id) !=
-            _gesturedParameters.end())
+        if (_gestures && _gestures->isActive(ev->param_id))
         {
           if (_automation) _automation->onPerformEdit(ev);
         }
@@ -769,7 +1186,7 @@ bool ProcessAdapter::enqueueOutputEvent(const clap_event_header_t* event)
           if (list)
           {
             Steinberg::int32 index2 = 0;
-            list->addPoint(ev->header.time, param->asVst3Value(ev->value), index2);
+            list->addPoint(ev->header.time, param.asVst3Value(ev->value), index2);
           }
         }
       }
@@ -783,9 +1200,12 @@ bool ProcessAdapter::enqueueOutputEvent(const clap_event_header_t* event)
     case CLAP_EVENT_PARAM_GESTURE_BEGIN:
     {
       auto ev = (clap_event_param_gesture*)event;
-      auto param = (Vst3Parameter*)this->parameters->getParameter(ev->param_id & 0x7FFFFFFF);
-      _gesturedParameters.push_back(param->getInfo().id);
-      if (_automation) _automation->onBeginEdit(param->getInfo().id);
+      auto slotIndex = findParameterSlot(ev->param_id);
+      if (slotIndex != ClapWrapper::detail::shared::ParamIndexMap::npos && _gestures &&
+          _gestures->begin(ev->param_id, (*_parameterTable)[slotIndex].vst3id))
+      {
+        if (_automation) _automation->onBeginEdit((*_parameterTable)[slotIndex].vst3id);
+      }
     }
       return true;
 
@@ -793,13 +1213,11 @@ bool ProcessAdapter::enqueueOutputEvent(const clap_event_header_t* event)
     case CLAP_EVENT_PARAM_GESTURE_END:
     {
       auto ev = (clap_event_param_gesture*)event;
-      auto param = (Vst3Parameter*)this->parameters->getParameter(ev->param_id & 0x7FFFFFFF);
-
-      auto n = std::remove(_gesturedParameters.begin(), _gesturedParameters.end(), param->getInfo().id);
-      if (n != _gesturedParameters.end())
+      // the parameter may have been removed meanwhile, the host gets its endEdit anyway
+      Steinberg::Vst::ParamID vst3id;
+      if (_gestures && _gestures->end(ev->param_id, vst3id))
       {
-        _gesturedParameters.erase(n, _gesturedParameters.end());
-        if (_automation) _automation->onEndEdit(param->getInfo().id);
+        if (_automation) _automation->onEndEdit(vst3id);
       }
     }
       return true;
@@ -816,33 +1234,37 @@ bool ProcessAdapter::enqueueOutputEvent(const clap_event_header_t* event)
   return false;
 }
 
-void ProcessAdapter::addToActiveNotes(const clap_event_note* note)
+uint32_t ProcessAdapter::findParameterSlot(clap_id id) const
 {
-  for (auto& i : _activeNotes)
+  // the VST3 parameter id is the CLAP id without the highest bit
+  if (!_parameterTable)
   {
-    if (!i.used)
-    {
-      i.note_id = note->note_id;
-      i.port_index = note->port_index;
-      i.channel = note->channel;
-      i.key = note->key;
-      i.used = true;
-      return;
-    }
+    return ClapWrapper::detail::shared::ParamIndexMap::npos;
   }
-  _activeNotes.emplace_back(ActiveNote{true, note->note_id, note->port_index, note->channel, note->key});
+  return _parameterTable->indexOf(id & 0x7FFFFFFF);
+}
+
+void ProcessAdapter::addToActiveNotes(const clap_event_note* note)
+{
+  // if the table is full, the note is counted as overflow and per-note events for it are dropped
+  _activeNotes.add(note->note_id, note->port_index, note->channel, note->key);
 }
 
 void ProcessAdapter::removeFromActiveNotes(const clap_event_note* note)
 {
-  for (auto& i : _activeNotes)
+  _activeNotes.remove(note->note_id, note->port_index, note->channel, note->key);
+}
+
+const ClapWrapper::detail::shared::ActiveNote* ProcessAdapter::findActiveNote(int32_t note_id,
+                                                                              int16_t channel,
+                                                                              int16_t key) const
+{
+  // some hosts don't provide note ids for poly pressure, the key is good enough then
+  if (note_id >= 0)
   {
-    if (i.used && i.port_index == note->port_index && i.channel == note->channel &&
-        i.note_id == note->note_id)
-    {
-      i.used = false;
-    }
+    return _activeNotes.findByNoteId(note_id);
   }
+  return _activeNotes.findByKey(0, channel, key);
 }
 
 }  // namespace Clap
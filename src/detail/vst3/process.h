@@ -22,6 +22,7 @@
 
 #include <pluginterfaces/vst/ivstevents.h>
 #include <pluginterfaces/vst/ivstaudioprocessor.h>
+#include <pluginterfaces/vst/ivstparameterchanges.h>
 #include <public.sdk/source/vst/vstparameters.h>
 #include <public.sdk/source/vst/vstbus.h>
 
@@ -33,6 +34,12 @@
 #include <memory>
 
 #include "../clap/automation.h"
+#include "../shared/processstatus.h"
+#include "../shared/eventsort.h"
+#include "../shared/eventarena.h"
+#include "../shared/activenotes.h"
+#include "../shared/processtiming.h"
+#include "parametertable.h"
 
 namespace Clap
 {
@@ -64,14 +71,35 @@ class ProcessAdapter
 		}
 #endif
 
+  ~ProcessAdapter();
+
   void setupProcessing(const clap_plugin_t* plugin, const clap_plugin_params_t* ext_params,
+                       const clap_plugin_audio_ports_t* ext_audioports,
+                       const clap_plugin_tail_t* ext_tail,
                        Steinberg::Vst::BusList& audioinputs, Steinberg::Vst::BusList& audiooutputs,
                        uint32_t numSamples, size_t numEventInputs, size_t numEventOutputs,
-                       Steinberg::Vst::ParameterContainer& params,
+                       ParameterTablePublisher* parameterTables, OpenGestures* gestures,
                        Steinberg::Vst::IComponentHandler* componenthandler, IAutomation* automation,
-                       bool enablePolyPressure, bool supportsTuningNoteExpression);
+                       bool enablePolyPressure, bool supportsTuningNoteExpression,
+                       bool use64bitSamples);
+  // prepares an adapter which is only used for flush(), this doesn't allocate
+  void setupFlushing(const clap_plugin_t* plugin, const clap_plugin_params_t* ext_params,
+                     ParameterTablePublisher* parameterTables, OpenGestures* gestures,
+                     Steinberg::Vst::IComponentHandler* componenthandler, IAutomation* automation);
   void process(Steinberg::Vst::ProcessData& data);
   void flush();
+  // lets a sleeping plugin process the next block
+  void wakeup();
+  // the phases of process() are accounted to timing, which is owned by the wrapper
+  void setProcessTiming(ClapWrapper::detail::shared::ProcessTiming* timing)
+  {
+    _timing = timing;
+  }
+  // [thread-safe] input events dropped since setupProcessing() because the arena was full
+  uint32_t eventOverflows() const
+  {
+    return _events.overflows();
+  }
   void processOutputParams(Steinberg::Vst::ProcessData& data);
   void activateAudioBus(Steinberg::Vst::BusDirection dir, Steinberg::int32 index,
                         Steinberg::TBool state);
@@ -87,34 +115,36 @@ class ProcessAdapter
  private:
   void sortEventIndices();
   void processInputEvents(Steinberg::Vst::IEventList* eventlist);
+  void processParameterQueue(Steinberg::Vst::IParamValueQueue* queue, const ParameterSlot& param);
+  void addParameterValueEvent(const ParameterSlot& param, Steinberg::int32 offset,
+                              Steinberg::Vst::ParamValue value);
+  void addMIDIControllerEvent(const ParameterSlot& param, Steinberg::int32 offset,
+                              Steinberg::Vst::ParamValue value);
 
   bool enqueueOutputEvent(const clap_event_header_t* event);
+  uint32_t findParameterSlot(clap_id id) const;
   void addToActiveNotes(const clap_event_note* note);
   void removeFromActiveNotes(const clap_event_note* note);
+  const ClapWrapper::detail::shared::ActiveNote* findActiveNote(int32_t note_id, int16_t channel,
+                                                                int16_t key) const;
 
   // the plugin
   const clap_plugin_t* _plugin = nullptr;
   const clap_plugin_params_t* _ext_params = nullptr;
+  const clap_plugin_tail_t* _ext_tail = nullptr;
 
-  Steinberg::Vst::ParameterContainer* parameters = nullptr;
+  // the parameters are only accessed through the table published by the wrapper,
+  // _parameterTable is valid during process() and flush()
+  ParameterTablePublisher* _parameterTables = nullptr;
+  const ParameterTable* _parameterTable = nullptr;
+  OpenGestures* _gestures = nullptr;
   Steinberg::Vst::IComponentHandler* _componentHandler = nullptr;
   IAutomation* _automation = nullptr;
   Steinberg::Vst::BusList* _audioinputs = nullptr;
   Steinberg::Vst::BusList* _audiooutputs = nullptr;
 
-  // for automation gestures
-  std::vector<clap_id> _gesturedParameters;
-
   // for INoteExpression
-  struct ActiveNote
-  {
-    bool used = false;
-    int32_t note_id;  // -1 if unspecified, otherwise >=0
-    int16_t port_index;
-    int16_t channel;  // 0..15
-    int16_t key;      // 0..127
-  };
-  std::vector<ActiveNote> _activeNotes;
+  ClapWrapper::detail::shared::ActiveNoteTable _activeNotes;
 
   clap_audio_buffer_t* _input_ports = nullptr;
   clap_audio_buffer_t* _output_ports = nullptr;
@@ -125,12 +155,47 @@ class ProcessAdapter
   float* _silent_input = nullptr;
   float* _silent_output = nullptr;
 
+  // 64 bit processing: ports which don't support 64 bit samples are converted
+  // into these preallocated 32 bit buffers
+  void setupBuffers64(const clap_plugin_audio_ports_t* ext_audioports, uint32_t numSamples);
+  bool connectBuffers64();
+  void convertOutputs64();
+
+  // silence flags <-> constant_mask
+  void updateInputConstantMasks();
+  void updateOutputSilenceFlags();
+
+  // skipping the plugin while it is sleeping
+  bool areInputsQuiet() const;
+  bool areOutputsQuiet() const;
+  void writeSilence();
+  ClapWrapper::detail::shared::ProcessStatusTracker _processStatus;
+
+  void markPhase(ClapWrapper::detail::shared::ProcessPhase phase)
+  {
+#if CLAP_WRAPPER_PROCESS_TIMING
+    if (_timing) _timing->mark(phase);
+#else
+    (void)phase;
+#endif
+  }
+  ClapWrapper::detail::shared::ProcessTiming* _timing = nullptr;
+
+  std::vector<bool> _input_port_64bit;
+  std::vector<bool> _output_port_64bit;
+  std::vector<float> _conversion_buffer;
+  std::vector<float*> _conversion_channels;
+  std::vector<size_t> _input_conversion_offset;
+  std::vector<size_t> _output_conversion_offset;
+  uint32_t _conversion_frames = 0;
+
   clap_process_t _processData = {-1, 0, &_transport, nullptr, nullptr, 0, 0, &_in_events, &_out_events};
 
   Steinberg::Vst::ProcessData* _vstdata = nullptr;
 
-  std::vector<clap_multi_event_t> _events;
-  std::vector<size_t> _eventindices;
+  // input events packed by size, in the order given to the plugin
+  ClapWrapper::detail::shared::EventArena _events;
+  ClapWrapper::detail::shared::EventIndexSorter _eventSorter;
 
   bool _supportsPolyPressure = false;
   bool _supportsTuningNoteExpression = false;
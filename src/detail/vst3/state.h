@@ -6,14 +6,62 @@
     This file is part of the clap-wrappers project which is released under MIT License.
     See file LICENSE or go to https://github.com/free-audio/clap-wrapper for full license details.
 
+    CLAPVST3StreamAdapter hands a VST3 IBStream to the CLAP as clap_istream/clap_ostream.
+
+    Reads and writes are buffered, so plugins writing their state in many small pieces don't
+    cause a host call for each of them, and transfers of more than 2 GiB are split into
+    chunks the 32 bit IBStream interface can take.
+
+    If the adapter is created with compress = true (CLAP_WRAPPER_VST3_COMPRESS_STATE) the
+    state is written in a compressed envelope:
+
+        magic       8 bytes "CLWRSTZ\x1a"
+        version     uint32 little endian, currently 1
+        flags       uint32 little endian, reserved (0)
+        blocks      rawSize uint32, storedSize uint32, storedSize bytes
+                    the block is stored uncompressed if storedSize == rawSize
+        end         a block header with rawSize 0
+
+    Reading detects the envelope by its magic and falls back to the raw state otherwise, so
+    states of earlier versions (and of builds without compression) still load. States with
+    a newer envelope version are rejected instead of passing garbage to the plugin.
+
+    Call finishWriting() after clap_plugin_state::save() and finishReading() after load().
+
+    copyTo() keeps the written bytes, so a state which didn't change can be handed to the host
+    again with writeTo() without asking the plugin (CLAP_WRAPPER_VST3_CACHE_STATE).
 */
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "detail/shared/lzblock.h"
+
+#ifndef CLAP_WRAPPER_VST3_COMPRESS_STATE
+#define CLAP_WRAPPER_VST3_COMPRESS_STATE 0
+#endif
+#ifndef CLAP_WRAPPER_VST3_CACHE_STATE
+#define CLAP_WRAPPER_VST3_CACHE_STATE 1
+#endif
+
 class CLAPVST3StreamAdapter
 {
  public:
-  CLAPVST3StreamAdapter(Steinberg::IBStream* stream) : vst_stream(stream)
+  explicit CLAPVST3StreamAdapter(Steinberg::IBStream* stream, bool compress = false)
+    : vst_stream(stream), _compress(compress)
+  {
+  }
+  ~CLAPVST3StreamAdapter()
   {
+    if (_writing && !_finished)
+    {
+      finishWriting();
+    }
   }
+  CLAPVST3StreamAdapter(const CLAPVST3StreamAdapter&) = delete;
+  CLAPVST3StreamAdapter& operator=(const CLAPVST3StreamAdapter&) = delete;
+
   operator const clap_istream_t*() const
   {
     return &in;
@@ -26,21 +74,422 @@ class CLAPVST3StreamAdapter
   static int64_t read(const struct clap_istream* stream, void* buffer, uint64_t size)
   {
     auto self = static_cast<CLAPVST3StreamAdapter*>(stream->ctx);
-    Steinberg::int32 bytesRead = 0;
-    if (kResultOk == self->vst_stream->read(buffer, (int32)size, &bytesRead)) return bytesRead;
-    return -1;
+    return self->readState(static_cast<uint8_t*>(buffer), size);
   }
   static int64_t write(const struct clap_ostream* stream, const void* buffer, uint64_t size)
   {
     auto self = static_cast<CLAPVST3StreamAdapter*>(stream->ctx);
-    Steinberg::int32 bytesWritten = 0;
-    if (kResultOk == self->vst_stream->write(const_cast<void*>(buffer), (int32)size, &bytesWritten))
-      return bytesWritten;
-    return -1;
+    return self->writeState(static_cast<const uint8_t*>(buffer), size);
+  }
+
+  // writes everything still buffered and closes the envelope, false if the stream failed
+  bool finishWriting()
+  {
+    _finished = true;
+    if (!_writing && _compress)
+    {
+      // an empty state still gets its envelope
+      _writing = true;
+      putHeader();
+    }
+    if (_compress && !_failed)
+    {
+      if (!packBlock())
+      {
+        _failed = true;
+      }
+      putBlockHeader(0, 0);
+    }
+    if (!_failed && !flushOut())
+    {
+      _failed = true;
+    }
+    return !_failed;
+  }
+
+  // keeps a copy of everything written to the stream (envelope included) in copy, as long as
+  // it stays below limit bytes, otherwise copy is left empty
+  void copyTo(std::vector<uint8_t>* copy, size_t limit)
+  {
+    _copy = copy;
+    _copyLimit = limit;
+    _copy->clear();
+  }
+
+  // writes bytes as they are, e.g. a copy taken with copyTo()
+  static bool writeTo(Steinberg::IBStream* stream, const uint8_t* buffer, uint64_t size)
+  {
+    uint64_t done = 0;
+    while (done < size)
+    {
+      auto chunk = (Steinberg::int32)std::min(size - done, maxChunk);
+      Steinberg::int32 bytesWritten = 0;
+      if (stream->write(const_cast<uint8_t*>(buffer + done), chunk, &bytesWritten) !=
+              Steinberg::kResultOk ||
+          bytesWritten <= 0)
+      {
+        return false;
+      }
+      done += (uint64_t)bytesWritten;
+    }
+    return true;
+  }
+
+  // gives bytes which were read ahead but not used back to the stream
+  void finishReading()
+  {
+    auto unused = _aheadLen - _aheadPos;
+    if (unused > 0)
+    {
+      vst_stream->seek(-(Steinberg::int64)unused, Steinberg::IBStream::kIBSeekCur, nullptr);
+      _aheadPos = _aheadLen = 0;
+    }
   }
 
  private:
+  using LzBlockEncoder = ClapWrapper::detail::shared::LzBlockEncoder;
+
+  static constexpr uint8_t envelopeMagic[8] = {'C', 'L', 'W', 'R', 'S', 'T', 'Z', 0x1a};
+  static constexpr uint32_t envelopeVersion = 1;
+  static constexpr size_t envelopeHeaderSize = 16;
+  // the size of the I/O buffers and of the blocks of the envelope
+  static constexpr size_t blockSize = 1 << 20;
+  // the largest transfer handed to IBStream at once
+  static constexpr uint64_t maxChunk = 1 << 30;
+
+  enum class Format
+  {
+    unknown,
+    raw,
+    envelope,
+    invalid
+  };
+
+  // --- reading
+
+  int64_t readState(uint8_t* buffer, uint64_t size)
+  {
+    if (_format == Format::unknown)
+    {
+      detectFormat();
+    }
+    switch (_format)
+    {
+      case Format::raw:
+        return readRaw(buffer, size);
+      case Format::envelope:
+        return readEnvelope(buffer, size);
+      default:
+        return -1;
+    }
+  }
+
+  void detectFormat()
+  {
+    _format = Format::raw;
+    if (fillAhead(envelopeHeaderSize) < 0)
+    {
+      _format = Format::invalid;
+      return;
+    }
+    if (_aheadLen - _aheadPos < envelopeHeaderSize ||
+        memcmp(&_ahead[_aheadPos], envelopeMagic, sizeof(envelopeMagic)) != 0)
+    {
+      return;
+    }
+    auto version = get32(&_ahead[_aheadPos + 8]);
+    _format = (version <= envelopeVersion) ? Format::envelope : Format::invalid;
+    _aheadPos += envelopeHeaderSize;
+  }
+
+  // makes sure at least wanted bytes are read ahead unless the stream ends, -1 on errors
+  int64_t fillAhead(size_t wanted)
+  {
+    if (_aheadLen - _aheadPos >= wanted)
+    {
+      return 0;
+    }
+    if (_ahead.empty())
+    {
+      _ahead.resize(blockSize);
+    }
+    if (_aheadPos > 0)
+    {
+      memmove(_ahead.data(), &_ahead[_aheadPos], _aheadLen - _aheadPos);
+      _aheadLen -= _aheadPos;
+      _aheadPos = 0;
+    }
+    while (_aheadLen < wanted)
+    {
+      auto r = streamRead(&_ahead[_aheadLen], _ahead.size() - _aheadLen);
+      if (r < 0) return -1;
+      if (r == 0) break;
+      _aheadLen += (size_t)r;
+    }
+    return 0;
+  }
+
+  // reads size bytes unless the stream ends, large reads go directly into the buffer
+  int64_t readRaw(uint8_t* buffer, uint64_t size)
+  {
+    uint64_t done = std::min<uint64_t>(size, _aheadLen - _aheadPos);
+    if (done > 0)
+    {
+      memcpy(buffer, &_ahead[_aheadPos], (size_t)done);
+      _aheadPos += (size_t)done;
+    }
+    while (done < size)
+    {
+      auto rest = size - done;
+      if (rest >= blockSize)
+      {
+        auto r = streamRead(buffer + done, rest);
+        if (r < 0) return done > 0 ? (int64_t)done : -1;
+        if (r == 0) break;
+        done += (uint64_t)r;
+        continue;
+      }
+      if (fillAhead(1) < 0) return done > 0 ? (int64_t)done : -1;
+      auto n = std::min<uint64_t>(rest, _aheadLen - _aheadPos);
+      if (n == 0) break;
+      memcpy(buffer + done, &_ahead[_aheadPos], (size_t)n);
+      _aheadPos += (size_t)n;
+      done += n;
+    }
+    return (int64_t)done;
+  }
+
+  int64_t readEnvelope(uint8_t* buffer, uint64_t size)
+  {
+    uint64_t done = 0;
+    while (done < size)
+    {
+      if (_blockPos == _blockLen)
+      {
+        if (_ended) break;
+        if (!unpackBlock())
+        {
+          _format = Format::invalid;
+          return -1;
+        }
+        continue;
+      }
+      auto n = std::min<uint64_t>(size - done, _blockLen - _blockPos);
+      memcpy(buffer + done, &_block[_blockPos], (size_t)n);
+      _blockPos += (size_t)n;
+      done += n;
+    }
+    return (int64_t)done;
+  }
+
+  bool unpackBlock()
+  {
+    uint8_t header[8];
+    if (readRaw(header, sizeof(header)) != (int64_t)sizeof(header)) return false;
+    auto rawSize = get32(header);
+    auto storedSize = get32(header + 4);
+    if (rawSize == 0)
+    {
+      _ended = true;
+      _blockPos = _blockLen = 0;
+      return true;
+    }
+    if (rawSize > blockSize || storedSize > LzBlockEncoder::bound(rawSize)) return false;
+
+    _block.resize(blockSize);
+    if (storedSize == rawSize)
+    {
+      if (readRaw(_block.data(), rawSize) != (int64_t)rawSize) return false;
+    }
+    else
+    {
+      _packed.resize(LzBlockEncoder::bound(blockSize));
+      if (readRaw(_packed.data(), storedSize) != (int64_t)storedSize) return false;
+      if (!ClapWrapper::detail::shared::lzBlockDecompress(_packed.data(), storedSize, _block.data(),
+                                                          rawSize))
+      {
+        return false;
+      }
+    }
+    _blockPos = 0;
+    _blockLen = rawSize;
+    return true;
+  }
+
+  // --- writing
+
+  int64_t writeState(const uint8_t* buffer, uint64_t size)
+  {
+    if (_failed) return -1;
+    if (!_writing)
+    {
+      _writing = true;
+      _out.reserve(blockSize);
+      if (_compress) putHeader();
+    }
+
+    uint64_t done = 0;
+    while (done < size)
+    {
+      auto rest = size - done;
+      if (!_compress && _out.empty() && rest >= blockSize)
+      {
+        // large writes bypass the buffer
+        if (!streamWrite(buffer + done, rest))
+        {
+          _failed = true;
+          return -1;
+        }
+        break;
+      }
+      auto n = (size_t)std::min<uint64_t>(rest, blockSize - _out.size());
+      _out.insert(_out.end(), buffer + done, buffer + done + n);
+      done += n;
+      if (_out.size() == blockSize)
+      {
+        if (!(_compress ? packBlock() : flushOut()))
+        {
+          _failed = true;
+          return -1;
+        }
+      }
+    }
+    return (int64_t)size;
+  }
+
+  void putHeader()
+  {
+    uint8_t header[envelopeHeaderSize] = {};
+    memcpy(header, envelopeMagic, sizeof(envelopeMagic));
+    put32(header + 8, envelopeVersion);
+    put32(header + 12, 0);
+    _pending.insert(_pending.end(), header, header + sizeof(header));
+  }
+
+  void putBlockHeader(uint32_t rawSize, uint32_t storedSize)
+  {
+    uint8_t header[8];
+    put32(header, rawSize);
+    put32(header + 4, storedSize);
+    _pending.insert(_pending.end(), header, header + sizeof(header));
+  }
+
+  // compresses the buffered data into a block and writes it
+  bool packBlock()
+  {
+    if (_out.empty())
+    {
+      return true;
+    }
+    _packed.resize(LzBlockEncoder::bound(blockSize));
+    auto rawSize = (uint32_t)_out.size();
+    auto packedSize = _encoder.compress(_out.data(), _out.size(), _packed.data(), _packed.size());
+    if (packedSize == 0 || packedSize >= rawSize)
+    {
+      putBlockHeader(rawSize, rawSize);
+      _pending.insert(_pending.end(), _out.begin(), _out.end());
+    }
+    else
+    {
+      putBlockHeader(rawSize, (uint32_t)packedSize);
+      _pending.insert(_pending.end(), _packed.begin(), _packed.begin() + packedSize);
+    }
+    _out.clear();
+    return flushPending();
+  }
+
+  // writes the buffered raw data (and the pending envelope bytes before them)
+  bool flushOut()
+  {
+    if (!flushPending()) return false;
+    if (_out.empty()) return true;
+    auto ok = streamWrite(_out.data(), _out.size());
+    _out.clear();
+    return ok;
+  }
+
+  bool flushPending()
+  {
+    if (_pending.empty()) return true;
+    auto ok = streamWrite(_pending.data(), _pending.size());
+    _pending.clear();
+    return ok;
+  }
+
+  // --- IBStream transfers in chunks the 32 bit interface can take
+
+  int64_t streamRead(uint8_t* buffer, uint64_t size)
+  {
+    uint64_t done = 0;
+    while (done < size)
+    {
+      auto chunk = (Steinberg::int32)std::min(size - done, maxChunk);
+      Steinberg::int32 bytesRead = 0;
+      if (vst_stream->read(buffer + done, chunk, &bytesRead) != Steinberg::kResultOk)
+      {
+        return done > 0 ? (int64_t)done : -1;
+      }
+      if (bytesRead <= 0) break;
+      done += (uint64_t)bytesRead;
+      if (bytesRead < chunk) break;
+    }
+    return (int64_t)done;
+  }
+
+  bool streamWrite(const uint8_t* buffer, uint64_t size)
+  {
+    if (_copy)
+    {
+      if (_copy->size() + size <= _copyLimit)
+      {
+        _copy->insert(_copy->end(), buffer, buffer + size);
+      }
+      else
+      {
+        // too large to keep, the caller sees an empty copy
+        std::vector<uint8_t>().swap(*_copy);
+        _copy = nullptr;
+      }
+    }
+    return writeTo(vst_stream, buffer, size);
+  }
+
+  static uint32_t get32(const uint8_t* p)
+  {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+  }
+  static void put32(uint8_t* p, uint32_t v)
+  {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+  }
+
   Steinberg::IBStream* vst_stream = nullptr;
   clap_istream_t in = {this, read};
   clap_ostream_t out = {this, write};
+
+  const bool _compress = false;
+
+  // reading
+  Format _format = Format::unknown;
+  std::vector<uint8_t> _ahead;  // bytes read from the stream but not consumed yet
+  size_t _aheadPos = 0;
+  size_t _aheadLen = 0;
+  std::vector<uint8_t> _block;  // the unpacked block of the envelope
+  size_t _blockPos = 0;
+  size_t _blockLen = 0;
+  bool _ended = false;
+
+  // writing
+  std::vector<uint8_t> _out;      // data of the plugin not written yet
+  std::vector<uint8_t> _pending;  // envelope bytes not written yet
+  std::vector<uint8_t> _packed;
+  LzBlockEncoder _encoder;
+  std::vector<uint8_t>* _copy = nullptr;
+  size_t _copyLimit = 0;
+  bool _writing = false;
+  bool _finished = false;
+  bool _failed = false;
 };
@@ -9,6 +9,8 @@
 #include "detail/vst3/process.h"
 #include "detail/vst3/parameter.h"
 #include "detail/clap/fsutil.h"
+#include <algorithm>
+#include <cstdio>
 #include <locale>
 #include <sstream>
 
@@ -42,86 +44,22 @@ struct ClapHostExtensions
 };
 #endif
 
-void utf8_to_utf16l(const char* utf8string, uint16_t* target, size_t targetsize)
-{
-  uint32_t codepoint = 0;
-  size_t targetpos = 0;
-
-  auto src = reinterpret_cast<const uint8_t*>(utf8string);
-  size_t pos = 0;
-  while (src[pos] && (targetpos < (targetsize - 2)))
-  {
-    auto byte = src[pos];
-
-    if ((byte & 0b10000000) == 0b00000000)
-    {
-      codepoint = byte;
-      pos += 1;
-    }
-    else
-    {
-      if (((byte & 0b11100000) == 0b11000000) && src[1])
-      {
-        codepoint = byte & 0b00011111;
-        codepoint = (codepoint << 6) | ((src[pos + 1]) & 0b00111111);
-        pos += 2;
-      }
-      else if (((byte & 0b11110000) == 0b11100000) && src[1] && src[2])
-      {
-        codepoint = byte & 0b00001111;
-        codepoint = (codepoint << 6) | ((src[pos + 1] & 0b00111111));
-        codepoint = (codepoint << 6) | ((src[pos + 2] & 0b00111111));
-        pos += 3;
-      }
-      else if (((byte & 0b11111000) == 0b11110000) && src[1] && src[2] && src[3])
-      {
-        codepoint = byte & 0b00000111;
-        codepoint = (codepoint << 6) | ((src[pos + 1] & 0b00111111));
-        codepoint = (codepoint << 6) | ((src[pos + 2] & 0b00111111));
-        codepoint = (codepoint << 6) | ((src[pos + 3] & 0b00111111));
-        pos += 4;
-      }
-      else
-      {
-        return;
-      }
-    }
-    {
-      if (codepoint >= 0xD800 && codepoint <= 0xDFFF)
-      {
-        target[targetpos] = 0;
-        return;
-        // throw conversion_error("illegal UTF-32 codepoint (surrogat area)");
-      }
-      if (codepoint <= 0xFFFF)
-      {
-        target[targetpos++] = codepoint;
-      }
-      else
-      {
-        if (codepoint <= 0x10FFFF && (targetpos < (targetsize - 3)))
-        {
-          codepoint -= 0x10000;
-          uint16_t highsurr = static_cast<uint16_t>((codepoint >> 10) + 0xD800);
-          uint16_t lowsurr = static_cast<uint16_t>((codepoint & 0x3FF) + 0xDC00);
-          target[targetpos++] = highsurr;
-          target[targetpos++] = lowsurr;
-        }
-        else
-        {
-          target[targetpos] = 0;
-          return;
-        }
-      }
-    }
-  }
-  target[targetpos] = 0;
-}
-
 tresult PLUGIN_API ClapAsVst3::initialize(FUnknown* context)
 {
   auto result = super::initialize(context);
   context->queryInterface(Vst::IHostApplication::iid, (void**)&vst3HostApplication);
+#if LIN
+  // hosts may provide a run loop through the context, this keeps timers and idle calls
+  // running without an editor
+  Steinberg::Linux::IRunLoop* runLoop = nullptr;
+  if (context->queryInterface(Steinberg::Linux::IRunLoop::iid, (void**)&runLoop) == kResultOk &&
+      runLoop)
+  {
+    _hostRunLoop = Steinberg::owned(runLoop);
+    os::addRunLoop(runLoop);
+    attachPosixFD(runLoop);
+  }
+#endif
   if (result == kResultOk)
   {
     if (!_plugin)
@@ -140,6 +78,8 @@ tresult PLUGIN_API ClapAsVst3::terminate()
 
   if (_plugin)
   {
+    _processTiming.dump(_plugin->_plugin->desc->name);
+    ClapWrapper::detail::shared::realtime::report(_plugin->_plugin->desc->name);
     _os_attached.off();  // ensure we are detached
     if (_active)
     {
@@ -150,6 +90,17 @@ tresult PLUGIN_API ClapAsVst3::terminate()
     _plugin.reset();
   }
 
+#if LIN
+  detachEditorRunLoop();
+  if (_hostRunLoop)
+  {
+    detachPosixFD(_hostRunLoop.get());
+    os::removeRunLoop(_hostRunLoop.get());
+    _hostRunLoop = nullptr;
+    _iRunLoop = nullptr;
+  }
+#endif
+
   return super::terminate();
 }
 
@@ -161,6 +112,7 @@ tresult PLUGIN_API ClapAsVst3::setActive(TBool state)
     if (!_plugin->activate()) return kResultFalse;
     _active = true;
     _processAdapter = new Clap::ProcessAdapter();
+    _reportedEventOverflows = 0;
 
     auto supportsnoteexpression =
         (_expressionmap & clap_supported_note_expressions::AS_VST3_NOTE_EXPRESSION_PRESSURE);
@@ -168,10 +120,13 @@ tresult PLUGIN_API ClapAsVst3::setActive(TBool state)
     // the processAdapter needs to know a few things to intercommunicate between VST3 host and CLAP plugin.
 
     _processAdapter->setupProcessing(
-        _plugin->_plugin, _plugin->_ext._params, this->audioInputs, this->audioOutputs,
-        this->_largestBlocksize, this->eventInputs.size(), this->eventOutputs.size(), parameters,
-        componentHandler, this, supportsnoteexpression,
-        _expressionmap & clap_supported_note_expressions::AS_VST3_NOTE_EXPRESSION_TUNING);
+        _plugin->_plugin, _plugin->_ext._params, _plugin->_ext._audioports, _plugin->_ext._tail,
+        this->audioInputs, this->audioOutputs, this->_largestBlocksize, this->eventInputs.size(),
+        this->eventOutputs.size(), &_parameterTables, &_openGestures, componentHandler, this,
+        supportsnoteexpression,
+        _expressionmap & clap_supported_note_expressions::AS_VST3_NOTE_EXPRESSION_TUNING,
+        _use64bitSamples);
+    _processAdapter->setProcessTiming(&_processTiming);
     updateAudioBusses();
 
     if (_missedLatencyRequest)
@@ -204,18 +159,34 @@ tresult PLUGIN_API ClapAsVst3::process(Vst::ProcessData& data)
   }
 
   ClapWrapper::detail::shared::SpinLockGuard spinLock(_processOrFlushLock);
+  ClapWrapper::detail::shared::realtime::Scope realtime;
 
-  auto thisFn = _plugin->AlwaysAudioThread();
+  // tags the host's process thread on its first block
+  ClapWrapper::detail::shared::AudioThreadEntry audioThread;
 
   // FIXME: At this transition we probably need to be careful that we aren't in a flush
   _processEverCalled = true;
+  _processTiming.beginBlock();
+  if (data.inputParameterChanges && data.inputParameterChanges->getParameterCount() > 0)
+  {
+    // automation changes the state without the plugin having to call mark_dirty
+    _stateGeneration.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (_requestedProcess.exchange(false))
+  {
+    _processAdapter->wakeup();
+  }
   this->_processAdapter->process(data);
+  _processTiming.endBlock(data.numSamples, _plugin->getSampleRate());
   return kResultOk;
 }
 
 tresult PLUGIN_API ClapAsVst3::canProcessSampleSize(int32 symbolicSampleSize)
 {
-  if (symbolicSampleSize != Steinberg::Vst::kSample32)
+  // 64 bit is passed natively to ports flagged with CLAP_AUDIO_PORT_SUPPORTS_64BITS,
+  // all other ports are converted by the ProcessAdapter
+  if (symbolicSampleSize != Steinberg::Vst::kSample32 &&
+      symbolicSampleSize != Steinberg::Vst::kSample64)
   {
     return kResultFalse;
   }
@@ -224,12 +195,45 @@ tresult PLUGIN_API ClapAsVst3::canProcessSampleSize(int32 symbolicSampleSize)
 
 tresult PLUGIN_API ClapAsVst3::setState(IBStream* state)
 {
-  return (_plugin->load(CLAPVST3StreamAdapter(state)) ? Steinberg::kResultOk : Steinberg::kResultFalse);
+  _stateGeneration.fetch_add(1, std::memory_order_relaxed);
+  CLAPVST3StreamAdapter stream(state);
+  auto loaded = _plugin->load(stream);
+  stream.finishReading();
+  return (loaded ? Steinberg::kResultOk : Steinberg::kResultFalse);
 }
 
 tresult PLUGIN_API ClapAsVst3::getState(IBStream* state)
 {
-  return (_plugin->save(CLAPVST3StreamAdapter(state)) ? Steinberg::kResultOk : Steinberg::kResultFalse);
+#if CLAP_WRAPPER_VST3_CACHE_STATE
+  // nothing happened since the last save which could have changed the state, so it is
+  // replayed without asking the plugin. Only plugins which have called mark_dirty at least
+  // once are trusted to report their changes.
+  auto generation = _stateGeneration.load(std::memory_order_relaxed);
+  if (_pluginMarksDirty && generation == _savedStateGeneration && !_savedState.empty())
+  {
+    return CLAPVST3StreamAdapter::writeTo(state, _savedState.data(), _savedState.size())
+               ? Steinberg::kResultOk
+               : Steinberg::kResultFalse;
+  }
+  _savedStateGeneration = 0;
+#endif
+
+  CLAPVST3StreamAdapter stream(state, CLAP_WRAPPER_VST3_COMPRESS_STATE);
+#if CLAP_WRAPPER_VST3_CACHE_STATE
+  if (_pluginMarksDirty)
+  {
+    stream.copyTo(&_savedState, maxSavedStateSize);
+  }
+#endif
+  if (!_plugin->save(stream) || !stream.finishWriting())
+  {
+    return Steinberg::kResultFalse;
+  }
+#if CLAP_WRAPPER_VST3_CACHE_STATE
+  // a change during save() bumped the generation already, so the copy is never stale
+  _savedStateGeneration = generation;
+#endif
+  return Steinberg::kResultOk;
 }
 
 uint32 PLUGIN_API ClapAsVst3::getLatencySamples()
@@ -267,7 +271,7 @@ uint32 PLUGIN_API ClapAsVst3::getTailSamples()
 
 tresult PLUGIN_API ClapAsVst3::setupProcessing(Vst::ProcessSetup& newSetup)
 {
-  if (newSetup.symbolicSampleSize != Vst::kSample32)
+  if (canProcessSampleSize(newSetup.symbolicSampleSize) != kResultOk)
   {
     return kResultFalse;
   }
@@ -291,6 +295,7 @@ tresult PLUGIN_API ClapAsVst3::setupProcessing(Vst::ProcessSetup& newSetup)
   _plugin->setBlockSizes(newSetup.maxSamplesPerBlock, newSetup.maxSamplesPerBlock);
 
   _largestBlocksize = newSetup.maxSamplesPerBlock;
+  _use64bitSamples = (newSetup.symbolicSampleSize == Vst::kSample64);
 
   return kResultOk;
 }
@@ -304,6 +309,7 @@ tresult PLUGIN_API ClapAsVst3::setProcessing(TBool state)
     if (!_processing)
     {
       _processing = true;
+      _requestedProcess = true;
 
       result = (_plugin->start_processing() ? Steinberg::kResultOk : Steinberg::kResultFalse);
     }
@@ -394,9 +400,7 @@ IPlugView* PLUGIN_API ClapAsVst3::createView(FIDString /*name*/)
             {
 #if LIN
               // the host calls the destructor, the wrapper just removes its pointer
-              detachTimers(_wrappedview->getRunLoop());
-              detachPosixFD(_wrappedview->getRunLoop());
-              _iRunLoop = nullptr;
+              detachEditorRunLoop();
 #endif
 
               clearContextMenu();
@@ -407,8 +411,7 @@ IPlugView* PLUGIN_API ClapAsVst3::createView(FIDString /*name*/)
           {
 
 #if LIN
-            attachTimers(_wrappedview->getRunLoop());
-            attachPosixFD(_wrappedview->getRunLoop());
+            attachEditorRunLoop(_wrappedview->getRunLoop());
 #else
             (void)this;  // silence warning on non-linux
 #endif
@@ -447,12 +450,22 @@ tresult PLUGIN_API ClapAsVst3::getParamStringByValue(Vst::ParamID id, Vst::Param
     return kResultOk;
   }
 
+  using ClapWrapper::detail::shared::ProcessCounter;
+  if (auto cached = _valueTextCache.find(id, valueNormalized))
+  {
+    _processTiming.count(ProcessCounter::textCacheHits);
+    memcpy(&string[0], cached, sizeof(Steinberg::Vst::String128));
+    return kResultOk;
+  }
+  _processTiming.count(ProcessCounter::textCacheMisses);
+
   char outbuf[128];
   memset(outbuf, 0, sizeof(outbuf));
 
   if (this->_plugin->_ext._params->value_to_text(_plugin->_plugin, param->id, val, outbuf, 127))
   {
     utf8_to_utf16l(outbuf, (uint16_t*)&string[0], str16BufferSize(Steinberg::Vst::String128));
+    _valueTextCache.insert(id, valueNormalized, (const uint16_t*)&string[0]);
 
     return kResultOk;
   }
@@ -537,14 +550,41 @@ tresult PLUGIN_API ClapAsVst3::setComponentHandler(Vst::IComponentHandler* handl
 
 //-----------------------------------------------------------------------------
 
+int32 PLUGIN_API ClapAsVst3::getParameterCount()
+{
+  return parameters.getParameterCount() + (int32)_midiProxies.size();
+}
+
+tresult PLUGIN_API ClapAsVst3::getParameterInfo(int32 paramIndex, Vst::ParameterInfo& info)
+{
+  // the MIDI proxies follow the CLAP parameters
+  auto numparams = parameters.getParameterCount();
+  if (paramIndex >= numparams)
+  {
+    return _midiProxies.getInfo((uint32_t)(paramIndex - numparams), info) ? kResultTrue : kResultFalse;
+  }
+  return super::getParameterInfo(paramIndex, info);
+}
+
+Vst::Parameter* ClapAsVst3::getParameterObject(Vst::ParamID tag)
+{
+  if (auto p = super::getParameterObject(tag))
+  {
+    return p;
+  }
+  return _midiProxies.get(tag);
+}
+
+//-----------------------------------------------------------------------------
+
 tresult PLUGIN_API ClapAsVst3::getMidiControllerAssignment(int32 busIndex, int16 channel,
                                                            Vst::CtrlNumber midiControllerNumber,
                                                            Vst::ParamID& id /*out*/)
 {
   // for my first Event bus and for MIDI channel 0 and for MIDI CC Volume only
-  if (busIndex == 0)  // && channel == 0) // && midiControllerNumber == Vst::kCtrlVolume)
+  if (busIndex == 0 && channel >= 0 && channel < _numMidiChannels)
   {
-    if (midiControllerNumber < Vst::kCountCtrlNumber)  // with program change
+    if (midiControllerNumber >= 0 && midiControllerNumber < Vst::kCountCtrlNumber)
     {
       id = _IMidiMappingIDs[channel][midiControllerNumber];
       return kResultTrue;
@@ -803,7 +843,9 @@ void ClapAsVst3::setupWrapperSpecifics(const clap_plugin_t* plugin)
   _vst3specifics = (clap_plugin_as_vst3_t*)plugin->get_extension(plugin, CLAP_PLUGIN_AS_VST3);
   if (_vst3specifics)
   {
-    _numMidiChannels = _vst3specifics->getNumMIDIChannels(_plugin->_plugin, 0);
+    // the MIDI proxies are only created for the channels of the first bus
+    _numMidiChannels = (uint8_t)std::min<uint32_t>(
+        _vst3specifics->getNumMIDIChannels(_plugin->_plugin, 0), std::size(_IMidiMappingIDs));
     _expressionmap = _vst3specifics->supportedNoteExpressions(_plugin->_plugin);
   }
 }
@@ -889,13 +931,40 @@ void ClapAsVst3::setupMIDIBusses(const clap_plugin_t* plugin, const clap_plugin_
   }
 }
 
+// the 128 programs of a MIDI channel, the names are made when the host asks for them
+class MidiProgramList : public Vst::ProgramList
+{
+ public:
+  MidiProgramList(Vst::ParamID paramId, Vst::UnitID unitId)
+    : Vst::ProgramList(STR16("Program Changes"), paramId, unitId)
+  {
+    info.programCount = 128;
+  }
+
+  tresult getProgramName(int32 programIndex, Vst::String128 name) override
+  {
+    if (programIndex < 0 || programIndex >= info.programCount)
+    {
+      return kResultFalse;
+    }
+    char buf[16];
+    snprintf(buf, sizeof(buf), "Program %d", programIndex + 1);
+    utf8_to_utf16l(buf, (uint16_t*)&name[0], str16BufferSize(Vst::String128));
+    return kResultTrue;
+  }
+};
+
 void ClapAsVst3::setupParameters(const clap_plugin_t* plugin, const clap_plugin_params_t* params)
 {
   if (!params) return;
 
-  // clear the units, they will be rebuild during the parameter conversion
+  // clear the units, program lists and note expressions, they will be rebuild during the
+  // parameter conversion
   _moduleToUnit.clear();
   units.clear();
+  programLists.clear();
+  programIndexMap.clear();
+  _noteExpressions.removeAll();
 
   {
     Vst::UnitInfo rootInfo;
@@ -910,23 +979,82 @@ void ClapAsVst3::setupParameters(const clap_plugin_t* plugin, const clap_plugin_
 
   auto numparams = params->count(plugin);
   parameters.removeAll();
+  _midiProxies.clear();
   this->parameters.init(numparams);
+
+  // the cookies are the only part of the parameters which differs between instances with
+  // the same layout, everything else is copied from the layout if another instance made it
+  std::vector<Clap::ParameterLayout::Entry> entries;
+  entries.reserve(numparams);
+  std::vector<void*> cookies;
+  cookies.reserve(numparams);
   for (decltype(numparams) i = 0; i < numparams; ++i)
   {
     clap_param_info info;
     if (params->get_info(plugin, i, &info))
     {
-      auto p = Vst3Parameter::create(
-          &info, [&](const char* modstring) { return this->getOrCreateUnitInfo(modstring); });
-      // auto p = Vst3Parameter::create(&info,nullptr);
-      p->param_index_for_clap_get_info = i;
-      parameters.addParameter(p);
+      entries.push_back(Clap::ParameterLayout::entryOf(i, &info));
+      cookies.push_back(info.cookie);
+    }
+    else
+    {
+      entries.push_back(Clap::ParameterLayout::entryOf(i, nullptr));
+    }
+  }
+
+  auto& layoutCache = Clap::ParameterLayoutCache::get();
+  auto layout = layoutCache.find(plugin->desc->id, Clap::ParameterLayout::hash(entries));
+  if (layout && layout->matches(entries))
+  {
+    for (const auto& unitInfo : layout->units)
+    {
+      addUnit(new Vst::Unit(unitInfo));
+    }
+    _moduleToUnit = layout->moduleToUnit;
+    for (size_t i = 0; i < cookies.size(); ++i)
+    {
+      parameters.addParameter(Vst3Parameter::create(*layout->parameters[i], cookies[i]));
+    }
+    _parameterLayout = std::move(layout);
+  }
+  else
+  {
+    // the entries are taken again, so they describe exactly the prototypes
+    auto newLayout = std::make_shared<Clap::ParameterLayout>();
+    newLayout->entries.reserve(numparams);
+    newLayout->parameters.reserve(cookies.size());
+    for (decltype(numparams) i = 0; i < numparams; ++i)
+    {
+      clap_param_info info;
+      if (params->get_info(plugin, i, &info))
+      {
+        auto p = Vst3Parameter::create(
+            &info, [&](const char* modstring) { return this->getOrCreateUnitInfo(modstring); });
+        // auto p = Vst3Parameter::create(&info,nullptr);
+        p->param_index_for_clap_get_info = i;
+        parameters.addParameter(p);
+        newLayout->addPrototype(*p);
+        newLayout->entries.push_back(Clap::ParameterLayout::entryOf(i, &info));
+      }
+      else
+      {
+        newLayout->entries.push_back(Clap::ParameterLayout::entryOf(i, nullptr));
+      }
+    }
+    for (size_t u = 1; u < units.size(); ++u)
+    {
+      newLayout->units.push_back(units[u]->getInfo());
     }
+    newLayout->moduleToUnit = _moduleToUnit;
+    auto layoutHash = Clap::ParameterLayout::hash(newLayout->entries);
+    _parameterLayout = newLayout;
+    layoutCache.insert(plugin->desc->id, layoutHash, std::move(newLayout));
   }
 
   if (_useIMidiMapping)
   {
-    // find free tags for IMidiMapping
+    // find free tags for IMidiMapping, the proxies only become parameter objects when the
+    // host addresses them, see getParameterObject()
     Vst::ParamID x = 0xb00000;
     _IMidiMappingEasy = true;
     _MIDIUnits.clear();
@@ -953,9 +1081,7 @@ void ClapAsVst3::setupParameters(const clap_plugin_t* plugin, const clap_plugin_
           _IMidiMappingEasy = false;
           x++;
         }
-        auto p = Vst3Parameter::create(0, channel, i, x);
-        p->setUnitID(midiUnitInfo.id);
-        parameters.addParameter(p);
+        _midiProxies.add(x, channel, (uint8_t)i);
         _IMidiMappingIDs[channel][i] = x++;
       }
       // if (false)
@@ -968,21 +1094,11 @@ void ClapAsVst3::setupParameters(const clap_plugin_t* plugin, const clap_plugin_
           _IMidiMappingEasy = false;
           x++;
         }
-        auto p = Vst3Parameter::create(0, channel, Vst::ControllerNumbers::kCtrlProgramChange, x);
-
-        p->setUnitID(midiUnitInfo.id);
+        _midiProxies.add(x, channel, Vst::ControllerNumbers::kCtrlProgramChange);
+        _midiProxies.setUnit(channel, midiUnitInfo.id);
         _MIDIUnits.emplace_back(midiUnitInfo.id);
 
-        parameters.addParameter(p);
-
-        auto programlist = new Steinberg::Vst::ProgramList(STR16("Program Changes"), x, midiUnitInfo.id);
-        for (int pc = 0; pc < 128; ++pc)
-        {
-          auto programname = fmt::format("Program {}", pc + 1);
-
-          programlist->addProgram(VST3::StringConvert::convert(programname).c_str());
-        }
-        this->addProgramList(programlist);
+        this->addProgramList(new MidiProgramList(x, midiUnitInfo.id));
 
         auto newUnit = new Vst::Unit(midiUnitInfo);
 
@@ -1027,56 +1143,103 @@ void ClapAsVst3::setupParameters(const clap_plugin_t* plugin, const clap_plugin_
                                     S16("Brit"), S16(""), 0, nullptr, 0));
 
   // PRESSURE is handled by IMidiMapping (-> Polypressure)
+
+  // the audio thread switches over to the new parameters with its next block
+  _parameterTables.publish(std::make_unique<Clap::ParameterTable>(parameters, _midiProxies));
 }
 
 void ClapAsVst3::param_rescan(clap_param_rescan_flags flags)
 {
+  auto params = _plugin->_ext._params;
+  if (!params) return;
+
+  // only parameters whose info or value actually changed are touched and the host is only
+  // told about what changed. The container is rebuilt if parameters appeared, vanished or
+  // moved to another module.
   auto vstflags = 0u;
-  if (flags & CLAP_PARAM_RESCAN_ALL)
+  auto rebuild = false;
+  auto republish = false;
+
+  if (flags & (CLAP_PARAM_RESCAN_TEXT | CLAP_PARAM_RESCAN_INFO | CLAP_PARAM_RESCAN_ALL))
   {
-    setupParameters(_plugin->_plugin, _plugin->_ext._params);
-    vstflags |= Vst::RestartFlags::kMidiCCAssignmentChanged;
+    _valueTextCache.clear();
   }
 
-  vstflags |=
-      ((flags & CLAP_PARAM_RESCAN_VALUES) ? (uint32_t)Vst::RestartFlags::kParamValuesChanged : 0u);
-  vstflags |= ((flags & CLAP_PARAM_RESCAN_INFO)
-                   ? Vst::RestartFlags::kParamValuesChanged | Vst::RestartFlags::kParamTitlesChanged
-                   : 0u);
+  if (flags & (CLAP_PARAM_RESCAN_ALL | CLAP_PARAM_RESCAN_INFO))
+  {
+    uint32_t numclap = 0;
+    auto len = parameters.getParameterCount();
+    for (decltype(len) i = 0; i < len && !rebuild; ++i)
+    {
+      auto p = static_cast<Vst3Parameter*>(parameters.getParameterByIndex(i));
+      if (p->isMidi) continue;
+      ++numclap;
 
-  if (vstflags == 0) return;
+      clap_param_info_t info;
+      if (!params->get_info(_plugin->_plugin, p->param_index_for_clap_get_info, &info) ||
+          info.id != p->id)
+      {
+        rebuild = true;
+        break;
+      }
+      auto fingerprint = Vst3Parameter::fingerprintOf(&info);
+      if (fingerprint.module != p->fingerprint.module)
+      {
+        rebuild = true;
+        break;
+      }
+      if (fingerprint.info != p->fingerprint.info)
+      {
+        // name, flags, range or default value, which is what the host reads from ParameterInfo
+        vstflags |= Vst::RestartFlags::kParamTitlesChanged;
+      }
+      if (fingerprint.info != p->fingerprint.info || info.cookie != p->cookie)
+      {
+        // a new cookie only concerns the audio thread
+        republish |= p->update(&info);
+      }
+    }
+    if ((flags & CLAP_PARAM_RESCAN_ALL) && numclap != params->count(_plugin->_plugin))
+    {
+      rebuild = true;
+    }
+  }
 
-  // update parameter values in our own tree
-  auto len = parameters.getParameterCount();
-  for (decltype(len) i = 0; i < len; ++i)
+  if (rebuild)
   {
-    auto p = static_cast<Vst3Parameter*>(parameters.getParameterByIndex(i));
-    if (!p->isMidi)
+    setupParameters(_plugin->_plugin, params);
+    vstflags |= Vst::RestartFlags::kMidiCCAssignmentChanged | Vst::RestartFlags::kParamTitlesChanged;
+  }
+  else if (republish)
+  {
+    // ranges or cookies changed, the audio thread needs a new table
+    _parameterTables.publish(std::make_unique<Clap::ParameterTable>(parameters, _midiProxies));
+  }
+
+  // update parameter values in our own tree, the normalized value is the last known one
+  if (rebuild || (flags & (CLAP_PARAM_RESCAN_VALUES | CLAP_PARAM_RESCAN_INFO | CLAP_PARAM_RESCAN_ALL)))
+  {
+    auto len = parameters.getParameterCount();
+    for (decltype(len) i = 0; i < len; ++i)
     {
+      auto p = static_cast<Vst3Parameter*>(parameters.getParameterByIndex(i));
       double val;
-      if (_plugin->_ext._params->get_value(_plugin->_plugin, p->id, &val))
+      if (!p->isMidi && params->get_value(_plugin->_plugin, p->id, &val))
       {
         auto newval = p->asVst3Value(val);
         if (p->getNormalized() != newval)
         {
           p->setNormalized(newval);
-        }
-      }
-      if (flags & CLAP_PARAM_RESCAN_INFO)
-      {
-        // In this case, the name and module can also change.
-        // For now, don't rebuild the unit tree with modules but
-        // do rescan the name
-        clap_param_info_t info;
-        if (_plugin->_ext._params->get_info(_plugin->_plugin, p->param_index_for_clap_get_info, &info))
-        {
-          str8ToStr16(p->getInfo().title, info.name, str16BufferSize(p->getInfo().title));
+          vstflags |= Vst::RestartFlags::kParamValuesChanged;
         }
       }
     }
   }
 
-  this->componentHandler->restartComponent(vstflags);
+  if (vstflags != 0 && componentHandler)
+  {
+    componentHandler->restartComponent(vstflags);
+  }
 }
 
 void ClapAsVst3::param_clear(clap_id param, clap_param_clear_flags flags)
@@ -1094,6 +1257,7 @@ void ClapAsVst3::param_clear(clap_id param, clap_param_clear_flags flags)
 void ClapAsVst3::param_request_flush()
 {
   _requestedFlush = true;
+  _wakeup.signal();
 }
 
 bool ClapAsVst3::gui_can_resize()
@@ -1135,12 +1299,21 @@ void ClapAsVst3::tail_changed()
 
 void ClapAsVst3::mark_dirty()
 {
+  _pluginMarksDirty = true;
+  _stateGeneration.fetch_add(1, std::memory_order_relaxed);
   if (componentHandler2) componentHandler2->setDirty(true);
 }
 
 void ClapAsVst3::request_callback()
 {
   _requestUICallback = true;
+  _wakeup.signal();
+}
+
+void ClapAsVst3::request_process()
+{
+  // picked up by the next process() call, a sleeping plugin will be woken up there
+  _requestedProcess = true;
 }
 
 void ClapAsVst3::restartPlugin()
@@ -1153,16 +1326,23 @@ void ClapAsVst3::restartPlugin()
 void ClapAsVst3::onBeginEdit(clap_id id)
 {
   // receive beginEdit and pass it to the internal queue
-  _queueToUI.push(beginEvent(id));
+  _queueToUI.begin(id);
 }
 void ClapAsVst3::onPerformEdit(const clap_event_param_value_t* value)
 {
-  // receive a value change and pass it to the internal queue
-  _queueToUI.push(valueEvent(value));
+  // receive a value change and pass it to the internal queue, the state generation was
+  // already bumped by onParameterOutput()
+  _queueToUI.value(value->param_id & 0x7FFFFFFF, value->value);
 }
 void ClapAsVst3::onEndEdit(clap_id id)
 {
-  _queueToUI.push(endEvent(id));
+  _queueToUI.end(id);
+}
+void ClapAsVst3::onParameterOutput(clap_id /*id*/)
+{
+  // values from preset recalls, MIDI learn or linked parameters change the state as well,
+  // gesture or not
+  _stateGeneration.fetch_add(1, std::memory_order_relaxed);
 }
 
 // ext-timer
@@ -1184,24 +1364,18 @@ bool ClapAsVst3::register_timer(uint32_t period_ms, clap_id* timer_id)
       // to make debugging a bit clearer
       to.timer_id = static_cast<clap_id>(i + 1000);
       to.period = period_ms;
-      to.nexttick = os::getTickInMS() + period_ms;
+      _timerScheduler.add(to.timer_id, period_ms, os::getTickInMS());
       // pass the id to the plugin
       *timer_id = to.timer_id;
-#if LIN
-      to.handler.reset();
-      attachTimers(_iRunLoop);
-#endif
       return true;
     }
   }
   // create a new timer object
   auto newid = (clap_id)(l + 1000);
-  TimerObject f{period_ms, os::getTickInMS() + period_ms, newid};
+  TimerObject f{period_ms, newid};
   *timer_id = newid;
   _timersObjects.push_back(f);
-#if LIN
-  attachTimers(_iRunLoop);
-#endif
+  _timerScheduler.add(newid, period_ms, os::getTickInMS());
 
   return true;
 }
@@ -1212,14 +1386,7 @@ bool ClapAsVst3::unregister_timer(clap_id timer_id)
     if (to.timer_id == timer_id)
     {
       to.period = 0;
-      to.nexttick = 0;
-#if LIN
-      if (to.handler && _iRunLoop)
-      {
-        _iRunLoop->unregisterTimer(to.handler.get());
-      }
-      to.handler.reset();
-#endif
+      _timerScheduler.remove(timer_id);
       return true;
     }
   }
@@ -1242,30 +1409,69 @@ const char* ClapAsVst3::host_get_name()
 
 void ClapAsVst3::onIdle()
 {
+  // parameter tables the audio thread has moved past
+  _parameterTables.reclaim();
+  _processTiming.idle(_plugin->_plugin->desc->name);
+
   // handling queued events
-  queueEvent n;
-  while (_queueToUI.pop(n))
-  {
-    switch (n._type)
-    {
-      case queueEvent::type_t::editstart:
-        beginEdit(n._data._id);
-        break;
-      case queueEvent::type_t::editvalue:
+  using Edit = decltype(_queueToUI)::Edit;
+  _queueToUI.drain(
+      [this](const Edit& e)
       {
-        auto param = (Vst3Parameter*)(parameters.getParameter(n._data._value.param_id & 0x7FFFFFFF));
-        auto v = n._data._value.value;
-        performEdit(param->getInfo().id, param->asVst3Value(v));
-      }
-      break;
-      case queueEvent::type_t::editend:
-        endEdit(n._data._id);
-        break;
-    }
+        switch (e.type)
+        {
+          case Edit::Type::begin:
+            beginEdit(e.id);
+            break;
+          case Edit::Type::value:
+          {
+            auto param = (Vst3Parameter*)(parameters.getParameter(e.id));
+            if (param)
+            {
+              performEdit(param->getInfo().id, param->asVst3Value(e.value));
+            }
+          }
+          break;
+          case Edit::Type::end:
+            endEdit(e.id);
+            break;
+        }
+      });
+  if (_queueToUI.overflows() != _reportedEditOverflows)
+  {
+    _reportedEditOverflows = _queueToUI.overflows();
+    LOGINFO("[clap-wrapper] {} parameter edits dropped, the edit queue was full", _reportedEditOverflows);
+  }
+  if (_processAdapter && _processAdapter->eventOverflows() != _reportedEventOverflows)
+  {
+    _reportedEventOverflows = _processAdapter->eventOverflows();
+    LOGINFO("[clap-wrapper] {} input events dropped, the event arena was full", _reportedEventOverflows);
   }
 
+  handleMainThreadRequests();
+
+  // handling timerobjects, only the ones which are due are touched
+  _timerScheduler.run(os::getTickInMS(), [this](clap_id timer_id) { fireTimer(timer_id); });
+}
+
+uint32_t ClapAsVst3::timerPeriod()
+{
+  return _timerScheduler.shortestPeriod();
+}
+
+void ClapAsVst3::fireTimer(clap_id timer_id)
+{
+  _plugin->_ext._timer->on_timer(_plugin->_plugin, timer_id);
+}
+
+void ClapAsVst3::handleMainThreadRequests()
+{
   if (_requestedFlush)
   {
+    // the flush adapter only takes pointers, nothing is allocated while the audio thread spins
+    _flushAdapter.setupFlushing(_plugin->_plugin, _plugin->_ext._params, &_parameterTables,
+                                &_openGestures, componentHandler, this);
+
     // Lock against ::process with a spin lock
     ClapWrapper::detail::shared::SpinLockGuard everLock(_processOrFlushLock);
     // Lock against setProcess with a mutex
@@ -1274,13 +1480,10 @@ void ClapAsVst3::onIdle()
     _requestedFlush = false;
     if (!_processing || !_processEverCalled)
     {
-      // setup a ProcessAdapter just for flush with no audio
-      Clap::ProcessAdapter pa;
-      pa.setupProcessing(_plugin->_plugin, _plugin->_ext._params, audioInputs, audioOutputs, 0, 0, 0,
-                         this->parameters, componentHandler, nullptr, false, false);
       auto thisFn = _plugin->AlwaysAudioThread();  // just to pacify the clap-helper
+      ClapWrapper::detail::shared::realtime::Scope realtime;
 
-      pa.flush();
+      _flushAdapter.flush();
     }
   }
 
@@ -1289,111 +1492,41 @@ void ClapAsVst3::onIdle()
     _requestUICallback = false;
     _plugin->_plugin->on_main_thread(_plugin->_plugin);
   }
-
-#if LIN
-  if (!_iRunLoop)  // don't process timers if we have a runloop.
-                   // (but if we don't have a runloop on linux onIdle isn't called
-                   // anyway so consider just not having this at all once we decide
-                   // to do with the no UI case)
-#endif
-  {
-    // handling timerobjects
-    auto now = os::getTickInMS();
-    for (auto&& to : _timersObjects)
-    {
-      if (to.period > 0 && to.nexttick < now)
-      {
-        to.nexttick = now + to.period;
-        this->_plugin->_ext._timer->on_timer(_plugin->_plugin, to.timer_id);
-      }
-    }
-  }
 }
 
 #if LIN
-struct TimerHandler : Steinberg::Linux::ITimerHandler, public Steinberg::FObject
+void ClapAsVst3::attachEditorRunLoop(Steinberg::Linux::IRunLoop* r)
 {
-  ClapAsVst3* _parent{nullptr};
-  clap_id _timerId{0};
-  TimerHandler(ClapAsVst3* parent, clap_id timerId) : _parent(parent), _timerId(timerId)
-  {
-  }
-  void PLUGIN_API onTimer() final
+  if (!r || r == _editorRunLoop)
   {
-    _parent->fireTimer(_timerId);
+    return;
   }
-  DELEGATE_REFCOUNT(Steinberg::FObject)
-  DEFINE_INTERFACES
-  DEF_INTERFACE(Steinberg::Linux::ITimerHandler)
-  END_DEFINE_INTERFACES(Steinberg::FObject)
-};
+  detachEditorRunLoop();
+  _editorRunLoop = r;
 
-struct IdleHandler : Steinberg::Linux::ITimerHandler, public Steinberg::FObject
-{
-  ClapAsVst3* _parent{nullptr};
-  IdleHandler(ClapAsVst3* parent) : _parent(parent)
-  {
-  }
-  void PLUGIN_API onTimer() final
+  // keep idling while the editor is open, even if the plugin is inactive
+  os::addRunLoop(r);
+  os::attach(this);
+  if (!_hostRunLoop)
   {
-    _parent->onIdle();
+    attachPosixFD(r);
   }
-  DELEGATE_REFCOUNT(Steinberg::FObject)
-  DEFINE_INTERFACES
-  DEF_INTERFACE(Steinberg::Linux::ITimerHandler)
-  END_DEFINE_INTERFACES(Steinberg::FObject)
-};
+}
 
-void ClapAsVst3::attachTimers(Steinberg::Linux::IRunLoop* r)
+void ClapAsVst3::detachEditorRunLoop()
 {
-  if (r)
+  if (!_editorRunLoop)
   {
-    _iRunLoop = r;
-
-    if (_idleHandler)
-    {
-      _iRunLoop->unregisterTimer(_idleHandler.get());
-    }
-    else
-    {
-      _idleHandler = Steinberg::owned(new IdleHandler(this));
-    }
-    _iRunLoop->registerTimer(_idleHandler.get(), 30);
-
-    for (auto& t : _timersObjects)
-    {
-      if (!t.handler)
-      {
-        t.handler = Steinberg::owned(new TimerHandler(this, t.timer_id));
-        _iRunLoop->registerTimer(t.handler.get(), t.period);
-      }
-    }
+    return;
   }
-}
-
-void ClapAsVst3::detachTimers(Steinberg::Linux::IRunLoop* r)
-{
-  if (r && r == _iRunLoop)
+  if (!_hostRunLoop)
   {
-    if (_idleHandler)
-    {
-      _iRunLoop->unregisterTimer(_idleHandler.get());
-      _idleHandler.reset();
-    }
-    for (auto& t : _timersObjects)
-    {
-      if (t.handler)
-      {
-        _iRunLoop->unregisterTimer(t.handler.get());
-        t.handler.reset();
-      }
-    }
+    detachPosixFD(_editorRunLoop);
+    _iRunLoop = nullptr;
   }
-}
-
-void ClapAsVst3::fireTimer(clap_id timer_id)
-{
-  _plugin->_ext._timer->on_timer(_plugin->_plugin, timer_id);
+  os::detach(this);
+  os::removeRunLoop(_editorRunLoop);
+  _editorRunLoop = nullptr;
 }
 
 bool ClapAsVst3::register_fd(int fd, clap_posix_fd_flags_t flags)
@@ -1458,12 +1591,35 @@ struct FDHandler : Steinberg::Linux::IEventHandler, public Steinberg::FObject
   DEF_INTERFACE(Steinberg::Linux::IEventHandler)
   END_DEFINE_INTERFACES(Steinberg::FObject)
 };
+
+struct WakeupHandler : Steinberg::Linux::IEventHandler, public Steinberg::FObject
+{
+  ClapAsVst3* _parent{nullptr};
+  WakeupHandler(ClapAsVst3* parent) : _parent(parent)
+  {
+  }
+  void PLUGIN_API onFDIsSet(Steinberg::Linux::FileDescriptor) override
+  {
+    _parent->fireWakeup();
+  }
+  DELEGATE_REFCOUNT(Steinberg::FObject)
+  DEFINE_INTERFACES
+  DEF_INTERFACE(Steinberg::Linux::IEventHandler)
+  END_DEFINE_INTERFACES(Steinberg::FObject)
+};
+
 void ClapAsVst3::attachPosixFD(Steinberg::Linux::IRunLoop* r)
 {
   if (r)
   {
     _iRunLoop = r;
 
+    if (!_wakeupHandler && _wakeup.fd() >= 0)
+    {
+      _wakeupHandler = Steinberg::owned(new WakeupHandler(this));
+      _iRunLoop->registerEventHandler(_wakeupHandler.get(), _wakeup.fd());
+    }
+
     for (auto& p : _posixFDObjects)
     {
       if (!p.handler)
@@ -1479,6 +1635,11 @@ void ClapAsVst3::detachPosixFD(Steinberg::Linux::IRunLoop* r)
 {
   if (r && r == _iRunLoop)
   {
+    if (_wakeupHandler)
+    {
+      _iRunLoop->unregisterEventHandler(_wakeupHandler.get());
+      _wakeupHandler.reset();
+    }
     for (auto& p : _posixFDObjects)
     {
       if (p.handler)
@@ -1494,6 +1655,15 @@ void ClapAsVst3::firePosixFDIsSet(int fd, clap_posix_fd_flags_t flags)
 {
   _plugin->_ext._posixfd->on_fd(_plugin->_plugin, fd, flags);
 }
+
+void ClapAsVst3::fireWakeup()
+{
+  _wakeup.drain();
+  if (_plugin)
+  {
+    handleMainThreadRequests();
+  }
+}
 #endif
 
 void wrapper_context_menu_item::vst3_to_clap(clap_id action_id)
@@ -32,67 +32,24 @@
 
 #include "detail/os/osutil.h"
 #include "detail/vst3/plugview.h"
+#include "detail/vst3/parametertable.h"
+#include "detail/vst3/midiproxies.h"
+#include "detail/vst3/parameterlayout.h"
+#include "detail/vst3/process.h"
 #include "detail/clap/automation.h"
-#include "detail/shared/fixedqueue.h"
+#include "detail/shared/editqueue.h"
+#include "detail/shared/timerscheduler.h"
 #include "detail/ara/ara.h"
 #include "detail/vst3/aravst3.h"
 #include "detail/shared/spinlock.h"
+#include "detail/shared/processtiming.h"
+#include "detail/shared/realtimeaudit.h"
+#include "detail/shared/wakeup.h"
+#include "detail/shared/textcache.h"
 #include <mutex>
 
 using namespace Steinberg;
 
-namespace Clap
-{
-class ProcessAdapter;
-}
-
-class queueEvent
-{
- public:
-  typedef enum class type
-  {
-    editstart,
-    editvalue,
-    editend,
-  } type_t;
-  type_t _type;
-  union
-  {
-    clap_id _id;
-    clap_event_param_value_t _value;
-  } _data;
-};
-
-class beginEvent : public queueEvent
-{
- public:
-  beginEvent(clap_id id) : queueEvent()
-  {
-    this->_type = type::editstart;
-    _data._id = id;
-  }
-};
-
-class endEvent : public queueEvent
-{
- public:
-  endEvent(clap_id id) : queueEvent()
-  {
-    this->_type = type::editend;
-    _data._id = id;
-  }
-};
-
-class valueEvent : public queueEvent
-{
- public:
-  valueEvent(const clap_event_param_value_t* value) : queueEvent()
-  {
-    _type = type::editvalue;
-    _data._value = *value;
-  }
-};
-
 struct wrapper_context_menu_item
 {
   Vst::IContextMenuItem vst3item;
@@ -162,6 +119,10 @@ class ClapAsVst3 : public Steinberg::Vst::SingleComponentEffect,
 
   // from IEditController
   tresult PLUGIN_API setComponentHandler(Vst::IComponentHandler* handler) override;
+  int32 PLUGIN_API getParameterCount() override;
+  tresult PLUGIN_API getParameterInfo(int32 paramIndex, Vst::ParameterInfo& info) override;
+  // the CLAP parameters and the MIDI proxies, which are created here on first use
+  Vst::Parameter* getParameterObject(Vst::ParamID tag) override;
 
   //----from IEditControllerEx1--------------------------------
   IPlugView* PLUGIN_API createView(FIDString name) override;
@@ -307,6 +268,8 @@ class ClapAsVst3 : public Steinberg::Vst::SingleComponentEffect,
 
   void request_callback() override;
 
+  void request_process() override;
+
   // clap_timer support
   bool register_timer(uint32_t period_ms, clap_id* timer_id) override;
   bool unregister_timer(clap_id timer_id) override;
@@ -331,12 +294,14 @@ class ClapAsVst3 : public Steinberg::Vst::SingleComponentEffect,
  public:
   //----from IPlugObject
   void onIdle() override;
+  uint32_t timerPeriod() override;
 
  private:
   // from Clap::IAutomation
   void onBeginEdit(clap_id id) override;
   void onPerformEdit(const clap_event_param_value_t* value) override;
   void onEndEdit(clap_id id) override;
+  void onParameterOutput(clap_id id) override;
 
   // information function to enable/disable the IMIDIMapping interface
   bool checkMIDIDialectSupport();
@@ -355,6 +320,22 @@ class ClapAsVst3 : public Steinberg::Vst::SingleComponentEffect,
   std::shared_ptr<Clap::Plugin> _plugin;
   clap_plugin_as_vst3_t* _vst3specifics = nullptr;
   Clap::ProcessAdapter* _processAdapter = nullptr;
+  Clap::ProcessAdapter _flushAdapter;  // for flushes while the host isn't processing
+  Clap::ParameterTablePublisher _parameterTables;
+  // keeps the shared layout alive in the cache as long as this instance uses it
+  std::shared_ptr<const Clap::ParameterLayout> _parameterLayout;
+  Clap::OpenGestures _openGestures;  // shared by _processAdapter and _flushAdapter
+  ClapWrapper::detail::shared::ProcessTiming _processTiming;
+  // texts from value_to_text, cleared on rescans of texts or infos
+  ClapWrapper::detail::shared::ValueTextCache<> _valueTextCache;
+  // the last state written by getState(), valid as long as _stateGeneration didn't move.
+  // The generation counts everything which may change the state: mark_dirty, parameter
+  // changes from the host or the plugin and loaded states.
+  std::vector<uint8_t> _savedState;
+  std::atomic<uint64_t> _stateGeneration{1};
+  uint64_t _savedStateGeneration = 0;
+  std::atomic<bool> _pluginMarksDirty{false};
+  static constexpr size_t maxSavedStateSize = 64 << 20;
   WrappedView* _wrappedview = nullptr;
 
   void* _creationcontext;  // context from the CLAP library
@@ -370,10 +351,16 @@ class ClapAsVst3 : public Steinberg::Vst::SingleComponentEffect,
   ClapWrapper::detail::shared::SpinLock _processOrFlushLock;
 
   std::atomic_bool _requestUICallback = false;
+  std::atomic_bool _requestedProcess = false;
+  // makes the run loop service flush and callback requests without waiting for the next idle
+  ClapWrapper::detail::shared::Wakeup _wakeup;
+  void handleMainThreadRequests();
   bool _missedLatencyRequest = false;
 
-  // the queue from audiothread to UI thread
-  ClapWrapper::detail::shared::fixedqueue<queueEvent, 8192> _queueToUI;
+  // the queue from audiothread to UI thread, values of a parameter are coalesced between idle calls
+  ClapWrapper::detail::shared::EditQueue<8192> _queueToUI;
+  uint64_t _reportedEditOverflows = 0;
+  uint32_t _reportedEventOverflows = 0;
 
   // for IMidiMapping
   bool _useIMidiMapping = false;
@@ -381,26 +368,30 @@ class ClapAsVst3 : public Steinberg::Vst::SingleComponentEffect,
       {};  // 16 MappingIDs for 16 Channels
   bool _IMidiMappingEasy = true;
   uint8_t _numMidiChannels = 16;
+  Clap::MidiProxies _midiProxies;
   uint32_t _largestBlocksize = 0;
+  bool _use64bitSamples = false;
 
   // for timer
   struct TimerObject
   {
     uint32_t period = 0;  // if period is 0 the entry is unused (and can be reused)
-    uint64_t nexttick = 0;
     clap_id timer_id = 0;
-#if LIN
-    Steinberg::IPtr<Steinberg::Linux::ITimerHandler> handler = nullptr;
-#endif
   };
   std::vector<TimerObject> _timersObjects;
+  // the deadlines of the timers which are driven by onIdle
+  ClapWrapper::detail::shared::TimerScheduler _timerScheduler;
 
 #if LIN
-  Steinberg::IPtr<Steinberg::Linux::ITimerHandler> _idleHandler;
-
-  void attachTimers(Steinberg::Linux::IRunLoop*);
-  void detachTimers(Steinberg::Linux::IRunLoop*);
+  // the run loop the posix fds are registered with, the one of the host context if there is
+  // one and otherwise the one of the editor
   Steinberg::Linux::IRunLoop* _iRunLoop{nullptr};
+  Steinberg::IPtr<Steinberg::Linux::IRunLoop> _hostRunLoop;
+
+  // the run loop of the open editor, it drives onIdle() while the editor is open
+  void attachEditorRunLoop(Steinberg::Linux::IRunLoop*);
+  void detachEditorRunLoop();
+  Steinberg::Linux::IRunLoop* _editorRunLoop{nullptr};
 #endif
 
 #if LIN
@@ -415,6 +406,7 @@ class ClapAsVst3 : public Steinberg::Vst::SingleComponentEffect,
     Steinberg::IPtr<Steinberg::Linux::IEventHandler> handler = nullptr;
   };
   std::vector<PosixFDObject> _posixFDObjects;
+  Steinberg::IPtr<Steinberg::Linux::IEventHandler> _wakeupHandler;
 
   void attachPosixFD(Steinberg::Linux::IRunLoop*);
   void detachPosixFD(Steinberg::Linux::IRunLoop*);
@@ -423,6 +415,7 @@ class ClapAsVst3 : public Steinberg::Vst::SingleComponentEffect,
  public:
   void fireTimer(clap_id timer_id);
   void firePosixFDIsSet(int fd, clap_posix_fd_flags_t flags);
+  void fireWakeup();
 
  private:
   // INoteExpression
@@ -0,0 +1,70 @@
+#pragma once
+
+/*
+    benchmark helpers
+
+    every benchmark is its own executable and prints one line per case. With --quick (which
+    is how ctest runs them) they only do a fraction of the repeats, that keeps them working
+    without making the test run slow. The numbers are only meaningful in a release build.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace bench
+{
+
+// the number of repeats for a case, full unless --quick is given
+inline uint32_t repeats(int argc, char** argv, uint32_t full)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--quick") == 0)
+    {
+      return std::max(full / 1000, 1u);
+    }
+  }
+  return full;
+}
+
+// nanoseconds per call of f, after one call to warm up
+template <typename F>
+double nsPerCall(uint32_t repeats, F f)
+{
+  f();
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < repeats; ++i)
+  {
+    f();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / repeats;
+}
+
+inline void report(const char* name, double ns, const char* per = "call")
+{
+  if (ns >= 1e6)
+  {
+    printf("%-48s %12.3f ms/%s\n", name, ns / 1e6, per);
+  }
+  else if (ns >= 1e3)
+  {
+    printf("%-48s %12.3f us/%s\n", name, ns / 1e3, per);
+  }
+  else
+  {
+    printf("%-48s %12.3f ns/%s\n", name, ns, per);
+  }
+}
+
+// keeps the compiler from optimizing a computation away
+inline volatile double sink = 0.;
+inline void keep(double v)
+{
+  sink = sink + v;
+}
+
+}  // namespace bench
@@ -0,0 +1,46 @@
+/*
+    constant buffer detection for hosts which don't set silence flags: what it costs to find
+    out a channel is silent (the whole buffer is read) and that it isn't (it stops early),
+    compared to a plugin doing minimal work on the channel
+*/
+
+#include "bench.h"
+#include "detail/shared/constantbuffer.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace ClapWrapper::detail::shared;
+
+int main(int argc, char** argv)
+{
+  const auto repeats = bench::repeats(argc, argv, 1000000);
+  constexpr uint32_t numSamples = 512;
+
+  std::vector<float> silent(numSamples, 0.f);
+  std::vector<float> signal(numSamples), out(numSamples);
+  for (uint32_t i = 0; i < numSamples; ++i)
+  {
+    signal[i] = (float)std::sin(0.01 * i);
+  }
+
+  auto detectSilent = bench::nsPerCall(repeats,
+                                       [&]() { bench::keep(isConstantBuffer(silent.data(), numSamples)); });
+  auto detectSignal = bench::nsPerCall(repeats,
+                                       [&]() { bench::keep(isConstantBuffer(signal.data(), numSamples)); });
+  auto gain = bench::nsPerCall(repeats,
+                               [&]()
+                               {
+                                 for (uint32_t i = 0; i < numSamples; ++i)
+                                 {
+                                   out[i] = silent[i] * 0.5f;
+                                 }
+                                 bench::keep(out[numSamples - 1]);
+                               });
+
+  printf("channel of %u samples\n", numSamples);
+  bench::report("detect a silent channel", detectSilent, "channel");
+  bench::report("detect a non silent channel", detectSignal, "channel");
+  bench::report("apply a gain (for comparison)", gain, "channel");
+  return 0;
+}
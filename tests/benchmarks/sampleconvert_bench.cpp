@@ -0,0 +1,92 @@
+/*
+    64 bit processing in the VST3 wrapper: a block of a stereo plugin on a 64 bit host,
+
+    - native: the plugin advertises CLAP_AUDIO_PORT_SUPPORTS_64BITS and gets data64
+    - wrapper: the wrapper converts into its scratch buffers with convertSamples()
+    - scalar: the plain conversion loops a host without the 64 bit path runs per insert
+*/
+
+#include "bench.h"
+#include "detail/shared/sampleconvert.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace ClapWrapper::detail::shared;
+
+namespace
+{
+constexpr uint32_t numSamples = 512;
+constexpr uint32_t numChannels = 2;
+
+// what the plugin does with the samples, the same for both precisions
+template <typename T>
+void process(const T* in, T* out, uint32_t n)
+{
+  for (uint32_t i = 0; i < n; ++i)
+  {
+    out[i] = in[i] * (T)0.5;
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  const auto repeats = bench::repeats(argc, argv, 200000);
+
+  std::vector<double> in64(numSamples * numChannels), out64(numSamples * numChannels);
+  std::vector<float> in32(numSamples * numChannels), out32(numSamples * numChannels);
+  for (size_t i = 0; i < in64.size(); ++i)
+  {
+    in64[i] = std::sin(0.01 * i);
+  }
+
+  auto native = bench::nsPerCall(repeats,
+                                 [&]()
+                                 {
+                                   for (uint32_t c = 0; c < numChannels; ++c)
+                                   {
+                                     auto o = c * numSamples;
+                                     process(&in64[o], &out64[o], numSamples);
+                                   }
+                                   bench::keep(out64[numSamples - 1]);
+                                 });
+
+  auto wrapper = bench::nsPerCall(repeats,
+                                  [&]()
+                                  {
+                                    for (uint32_t c = 0; c < numChannels; ++c)
+                                    {
+                                      auto o = c * numSamples;
+                                      convertSamples(&in64[o], &in32[o], numSamples);
+                                      process(&in32[o], &out32[o], numSamples);
+                                      convertSamples(&out32[o], &out64[o], numSamples);
+                                    }
+                                    bench::keep(out64[numSamples - 1]);
+                                  });
+
+  auto scalar = bench::nsPerCall(repeats,
+                                 [&]()
+                                 {
+                                   for (uint32_t c = 0; c < numChannels; ++c)
+                                   {
+                                     auto o = c * numSamples;
+                                     for (uint32_t i = 0; i < numSamples; ++i)
+                                     {
+                                       in32[o + i] = static_cast<float>(in64[o + i]);
+                                     }
+                                     process(&in32[o], &out32[o], numSamples);
+                                     for (uint32_t i = 0; i < numSamples; ++i)
+                                     {
+                                       out64[o + i] = static_cast<double>(out32[o + i]);
+                                     }
+                                   }
+                                   bench::keep(out64[numSamples - 1]);
+                                 });
+
+  printf("stereo block of %u samples\n", numSamples);
+  bench::report("native 64 bit", native, "block");
+  bench::report("wrapper conversion (convertSamples)", wrapper, "block");
+  bench::report("scalar conversion", scalar, "block");
+  return 0;
+}
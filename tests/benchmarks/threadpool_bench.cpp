@@ -0,0 +1,131 @@
+/*
+    clap_host_thread_pool: a synthetic many-voice plugin rendering one block, every voice an
+    independent task with a few oscillators, mixed down on the calling thread afterwards
+
+    - single threaded: the plugin renders all voices in its process() call
+    - thread pool: the voices are handed to ThreadPool::run() like request_exec() does
+
+    for growing numbers of voices, so the scaling with the number of workers shows as well as
+    the point where the overhead of a run() is paid back
+*/
+
+#include "bench.h"
+#include "detail/shared/threadpool.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace ClapWrapper::detail::shared;
+
+namespace
+{
+constexpr uint32_t blockSize = 256;
+constexpr uint32_t oscillatorsPerVoice = 8;
+
+struct Synth
+{
+  uint32_t numVoices = 0;
+  std::vector<float> phases;  // of all oscillators
+  std::vector<float> voiceOut;
+  std::vector<float> mix;
+
+  explicit Synth(uint32_t voices)
+    : numVoices(voices)
+    , phases(voices * oscillatorsPerVoice)
+    , voiceOut(voices * blockSize)
+    , mix(blockSize)
+  {
+  }
+
+  void renderVoice(uint32_t voice)
+  {
+    auto out = &voiceOut[voice * blockSize];
+    for (uint32_t s = 0; s < blockSize; ++s)
+    {
+      out[s] = 0.f;
+    }
+    for (uint32_t o = 0; o < oscillatorsPerVoice; ++o)
+    {
+      auto& phase = phases[voice * oscillatorsPerVoice + o];
+      const auto increment = 0.001f * (float)(1 + voice + o);
+      for (uint32_t s = 0; s < blockSize; ++s)
+      {
+        out[s] += std::sin(phase);
+        phase += increment;
+      }
+      phase = std::fmod(phase, 6.2831853f);
+    }
+  }
+
+  static void renderTask(void* context, uint32_t voice)
+  {
+    static_cast<Synth*>(context)->renderVoice(voice);
+  }
+
+  void mixDown()
+  {
+    for (uint32_t s = 0; s < blockSize; ++s)
+    {
+      mix[s] = 0.f;
+    }
+    for (uint32_t v = 0; v < numVoices; ++v)
+    {
+      for (uint32_t s = 0; s < blockSize; ++s)
+      {
+        mix[s] += voiceOut[v * blockSize + s];
+      }
+    }
+    bench::keep(mix[blockSize - 1]);
+  }
+};
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  auto pool = ThreadPool::acquire();
+  printf("thread pool with %u workers, blocks of %u samples, %u oscillators per voice\n",
+         pool->numWorkers(), blockSize, oscillatorsPerVoice);
+
+  bool pooled = true;
+  for (uint32_t numVoices : {1u, 4u, 16u, 64u, 256u})
+  {
+    Synth synth(numVoices);
+    const auto repeats = bench::repeats(argc, argv, 64000 / numVoices);
+
+    auto single = bench::nsPerCall(repeats,
+                                   [&]()
+                                   {
+                                     for (uint32_t v = 0; v < numVoices; ++v)
+                                     {
+                                       synth.renderVoice(v);
+                                     }
+                                     synth.mixDown();
+                                   });
+
+    auto parallel = bench::nsPerCall(repeats,
+                                     [&]()
+                                     {
+                                       if (!pool->run(&Synth::renderTask, &synth, numVoices))
+                                       {
+                                         // what a plugin does if request_exec() fails
+                                         pooled = false;
+                                         for (uint32_t v = 0; v < numVoices; ++v)
+                                         {
+                                           synth.renderVoice(v);
+                                         }
+                                       }
+                                       synth.mixDown();
+                                     });
+
+    char name[64];
+    snprintf(name, sizeof(name), "%u voices, single threaded", numVoices);
+    bench::report(name, single, "block");
+    snprintf(name, sizeof(name), "%u voices, thread pool (%.2fx)", numVoices, single / parallel);
+    bench::report(name, parallel, "block");
+  }
+  if (!pooled)
+  {
+    printf("the pool refused some runs, those were rendered single threaded\n");
+  }
+  return 0;
+}
@@ -0,0 +1,309 @@
+/*
+    parameter handling of the VST3 wrapper, built from the wrapper sources against the VST3 SDK
+    with a synthetic CLAP parameter list instead of a plugin
+
+    - rescan: what param_rescan() does per parameter (fingerprint check and update) compared
+      to rebuilding all Vst3Parameter objects like a rescan did before
+    - MIDI proxies: the IMidiMapping parameters of 16 channels as Vst3Parameter objects, like
+      they were created before, compared to MidiProxies which only makes them on demand
+    - instances: the parameters of N instances of the same plugin, each converting the CLAP
+      infos on its own compared to sharing a ParameterLayout like setupParameters() does
+*/
+
+#include "bench.h"
+#include "detail/vst3/parameter.h"
+#include "detail/vst3/parametertable.h"
+#include "detail/vst3/midiproxies.h"
+#include "detail/vst3/parameterlayout.h"
+
+#include <public.sdk/source/vst/utility/stringconvert.h>
+#include <pluginterfaces/vst/ivstmidicontrollers.h>
+#include <pluginterfaces/vst/ivstunits.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Vst = Steinberg::Vst;
+
+namespace
+{
+
+// a modular synth: slots of parameters, every slot is a module
+std::vector<clap_param_info_t> makeInfos(uint32_t numParams, uint32_t paramsPerSlot)
+{
+  std::vector<clap_param_info_t> infos(numParams);
+  for (uint32_t i = 0; i < numParams; ++i)
+  {
+    auto& info = infos[i];
+    info = {};
+    info.id = 1000 + i;
+    info.flags = CLAP_PARAM_IS_AUTOMATABLE;
+    info.cookie = &infos[i];
+    snprintf(info.name, sizeof(info.name), "Parameter %u", i % paramsPerSlot);
+    snprintf(info.module, sizeof(info.module), "Slot %u", i / paramsPerSlot);
+    info.min_value = 0.;
+    info.max_value = 1.;
+    info.default_value = 0.5;
+  }
+  return infos;
+}
+
+// the units of the modules, like ClapAsVst3::getOrCreateUnitInfo() for paths of one level
+struct Units
+{
+  std::map<std::string, Vst::UnitID> moduleToUnit;
+  std::vector<Vst::UnitInfo> units;
+
+  Vst::UnitID get(const char* module)
+  {
+    auto it = moduleToUnit.find(module);
+    if (it != moduleToUnit.end())
+    {
+      return it->second;
+    }
+    Vst::UnitInfo info{};
+    info.id = (Vst::UnitID)units.size() + 1;
+    info.parentUnitId = Vst::kRootUnitId;
+    VST3::StringConvert::convert(std::string(module), info.name);
+    units.push_back(info);
+    moduleToUnit[module] = info.id;
+    return info.id;
+  }
+
+  void clear()
+  {
+    moduleToUnit.clear();
+    units.clear();
+  }
+};
+
+void build(Vst::ParameterContainer& parameters, Units& units, const std::vector<clap_param_info_t>& infos)
+{
+  parameters.removeAll();
+  parameters.init((Steinberg::int32)infos.size());
+  units.clear();
+  for (uint32_t i = 0; i < infos.size(); ++i)
+  {
+    auto p = Vst3Parameter::create(&infos[i], [&](const char* module) { return units.get(module); });
+    p->param_index_for_clap_get_info = i;
+    parameters.addParameter(p);
+  }
+}
+
+// the per parameter part of param_rescan(), returns the number of updated parameters
+uint32_t rescan(Vst::ParameterContainer& parameters, const std::vector<clap_param_info_t>& infos)
+{
+  uint32_t updated = 0;
+  auto len = parameters.getParameterCount();
+  for (decltype(len) i = 0; i < len; ++i)
+  {
+    auto p = static_cast<Vst3Parameter*>(parameters.getParameterByIndex(i));
+    auto& info = infos[p->param_index_for_clap_get_info];
+    auto fingerprint = Vst3Parameter::fingerprintOf(&info);
+    if (fingerprint.info != p->fingerprint.info || info.cookie != p->cookie)
+    {
+      p->update(&info);
+      ++updated;
+    }
+  }
+  return updated;
+}
+
+void benchRescan(uint32_t repeats)
+{
+  constexpr uint32_t numParams = 10000;
+  auto infos = makeInfos(numParams, 100);
+  // the same list with a renamed slot
+  auto renamed = infos;
+  for (uint32_t i = 0; i < 100; ++i)
+  {
+    snprintf(renamed[i].name, sizeof(renamed[i].name), "Renamed %u", i);
+  }
+
+  Vst::ParameterContainer parameters;
+  Units units;
+  build(parameters, units, infos);
+
+  auto rebuild = bench::nsPerCall(repeats, [&]() { build(parameters, units, infos); });
+  auto unchanged = bench::nsPerCall(repeats, [&]() { bench::keep(rescan(parameters, infos)); });
+  bool toggle = false;
+  auto slotRenamed = bench::nsPerCall(repeats,
+                                      [&]()
+                                      {
+                                        toggle = !toggle;
+                                        bench::keep(rescan(parameters, toggle ? renamed : infos));
+                                      });
+
+  printf("rescan of %u parameters in %u modules\n", numParams, numParams / 100);
+  bench::report("rebuild all parameters", rebuild, "rescan");
+  bench::report("rescan, nothing changed", unchanged, "rescan");
+  bench::report("rescan, 100 parameters renamed", slotRenamed, "rescan");
+}
+
+void benchMidiProxies(uint32_t repeats)
+{
+  constexpr uint8_t numChannels = 16;
+  constexpr uint32_t perChannel = Vst::ControllerNumbers::kCountCtrlNumber + 1;  // and program change
+  Vst::ParameterContainer parameters;
+  Clap::MidiProxies proxies;
+
+  const Clap::MidiProxies noProxies;
+  auto controllerOf = [](uint32_t i) -> uint8_t
+  {
+    return (i < Vst::ControllerNumbers::kCountCtrlNumber) ? i : (uint32_t)Vst::ControllerNumbers::kCtrlProgramChange;
+  };
+
+  auto eager = bench::nsPerCall(repeats,
+                                [&]()
+                                {
+                                  parameters.removeAll();
+                                  parameters.init(numChannels * perChannel);
+                                  Vst::ParamID x = 0xb00000;
+                                  for (uint8_t channel = 0; channel < numChannels; ++channel)
+                                  {
+                                    for (uint32_t i = 0; i < perChannel; ++i)
+                                    {
+                                      auto p = Vst3Parameter::create(0, channel, controllerOf(i), x++);
+                                      p->setUnitID(channel + 1);
+                                      parameters.addParameter(p);
+                                    }
+                                  }
+                                  Clap::ParameterTable table(parameters, noProxies);
+                                  bench::keep(table.size());
+                                });
+  parameters.removeAll();
+
+  auto onDemand = bench::nsPerCall(repeats,
+                                   [&]()
+                                   {
+                                     proxies.clear();
+                                     Vst::ParamID x = 0xb00000;
+                                     for (uint8_t channel = 0; channel < numChannels; ++channel)
+                                     {
+                                       for (uint32_t i = 0; i < perChannel; ++i)
+                                       {
+                                         proxies.add(x++, channel, controllerOf(i));
+                                       }
+                                       proxies.setUnit(channel, channel + 1);
+                                     }
+                                     Clap::ParameterTable table(parameters, proxies);
+                                     bench::keep(table.size());
+                                   });
+
+  // what a host listing all parameters costs on top
+  auto enumerate = bench::nsPerCall(repeats,
+                                    [&]()
+                                    {
+                                      Vst::ParameterInfo info;
+                                      for (uint32_t i = 0; i < proxies.size(); ++i)
+                                      {
+                                        proxies.getInfo(i, info);
+                                      }
+                                      bench::keep(info.id);
+                                    });
+
+  const auto count = numChannels * perChannel;
+  printf("MIDI proxies of %u channels, %u parameters\n", numChannels, count);
+  bench::report("Vst3Parameter objects", eager, "instance");
+  bench::report("MidiProxies", onDemand, "instance");
+  bench::report("MidiProxies, host enumerates all", enumerate, "instance");
+  // the heap blocks of the parameter objects and their container aren't counted
+  printf("%-48s %12zu bytes\n", "Vst3Parameter objects (object size only)", count * sizeof(Vst3Parameter));
+  printf("%-48s %12zu bytes\n", "MidiProxies", count * sizeof(Clap::MidiProxies::Proxy));
+}
+
+// the parameter part of ClapAsVst3::setupParameters()
+void setupShared(Vst::ParameterContainer& parameters, std::shared_ptr<const Clap::ParameterLayout>& held,
+                 const std::vector<clap_param_info_t>& infos)
+{
+  static const char* pluginId = "org.free-audio.clap-wrapper-bench";
+  const auto numparams = (uint32_t)infos.size();
+
+  std::vector<Clap::ParameterLayout::Entry> entries;
+  entries.reserve(numparams);
+  std::vector<void*> cookies;
+  cookies.reserve(numparams);
+  for (uint32_t i = 0; i < numparams; ++i)
+  {
+    entries.push_back(Clap::ParameterLayout::entryOf(i, &infos[i]));
+    cookies.push_back(infos[i].cookie);
+  }
+
+  parameters.init((Steinberg::int32)numparams);
+  auto& cache = Clap::ParameterLayoutCache::get();
+  auto layout = cache.find(pluginId, Clap::ParameterLayout::hash(entries));
+  if (layout && layout->matches(entries))
+  {
+    for (size_t i = 0; i < cookies.size(); ++i)
+    {
+      parameters.addParameter(Vst3Parameter::create(*layout->parameters[i], cookies[i]));
+    }
+    held = std::move(layout);
+    return;
+  }
+
+  Units units;
+  auto newLayout = std::make_shared<Clap::ParameterLayout>();
+  for (uint32_t i = 0; i < numparams; ++i)
+  {
+    auto p = Vst3Parameter::create(&infos[i], [&](const char* module) { return units.get(module); });
+    p->param_index_for_clap_get_info = i;
+    parameters.addParameter(p);
+    newLayout->addPrototype(*p);
+  }
+  newLayout->entries = std::move(entries);
+  newLayout->units = units.units;
+  newLayout->moduleToUnit = units.moduleToUnit;
+  held = newLayout;
+  cache.insert(pluginId, Clap::ParameterLayout::hash(newLayout->entries), std::move(newLayout));
+}
+
+void benchInstances(uint32_t repeats)
+{
+  constexpr uint32_t numInstances = 64;
+  constexpr uint32_t numParams = 2000;
+  auto infos = makeInfos(numParams, 100);
+
+  // every repeat creates all instances and releases them again
+  auto own = bench::nsPerCall(repeats,
+                              [&]()
+                              {
+                                std::vector<std::unique_ptr<Vst::ParameterContainer>> instances;
+                                for (uint32_t n = 0; n < numInstances; ++n)
+                                {
+                                  instances.emplace_back(std::make_unique<Vst::ParameterContainer>());
+                                  Units units;
+                                  build(*instances.back(), units, infos);
+                                }
+                              });
+
+  auto shared = bench::nsPerCall(repeats,
+                                 [&]()
+                                 {
+                                   std::vector<std::unique_ptr<Vst::ParameterContainer>> instances;
+                                   std::vector<std::shared_ptr<const Clap::ParameterLayout>> layouts(
+                                       numInstances);
+                                   for (uint32_t n = 0; n < numInstances; ++n)
+                                   {
+                                     instances.emplace_back(std::make_unique<Vst::ParameterContainer>());
+                                     setupShared(*instances.back(), layouts[n], infos);
+                                   }
+                                   bench::keep(layouts[0] == layouts[numInstances - 1]);
+                                 });
+
+  printf("%u instances with %u parameters each\n", numInstances, numParams);
+  bench::report("every instance converts the infos", own, "load");
+  bench::report("instances share a ParameterLayout", shared, "load");
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  benchRescan(bench::repeats(argc, argv, 200));
+  benchMidiProxies(bench::repeats(argc, argv, 2000));
+  benchInstances(bench::repeats(argc, argv, 20));
+  return 0;
+}
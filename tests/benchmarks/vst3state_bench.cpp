@@ -0,0 +1,185 @@
+/*
+    saving and loading a state through CLAPVST3StreamAdapter into an in-memory IBStream, with a
+    plugin writing and reading its state in small pieces
+
+    - direct: every piece is its own IBStream call, like the adapter did before it buffered
+    - buffered: the adapter collects the pieces into large transfers
+    - compressed: the buffered adapter with the envelope of CLAP_WRAPPER_VST3_COMPRESS_STATE
+
+    for a preset-like state (text and zeroed tables) and a sample-like state which hardly
+    compresses
+*/
+
+#include "bench.h"
+
+#include <clap/clap.h>
+#include <public.sdk/source/common/memorystream.h>
+
+#include "detail/vst3/state.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr size_t pieceSize = 64;
+
+std::vector<uint8_t> presetState(size_t size)
+{
+  std::vector<uint8_t> data(size, 0);
+  std::string text;
+  for (uint32_t i = 0; text.size() < size / 4; ++i)
+  {
+    text += "<param id=\"" + std::to_string(i) + "\" value=\"0.5\"/>\n";
+  }
+  memcpy(data.data(), text.data(), size / 4);
+  return data;
+}
+
+std::vector<uint8_t> sampleState(size_t size)
+{
+  std::mt19937 random(42);
+  std::vector<uint8_t> data(size);
+  for (size_t i = 0; i + sizeof(float) <= size; i += sizeof(float))
+  {
+    float v = std::sin(0.001f * (float)i) + 0.01f * (float)(random() % 1000);
+    memcpy(&data[i], &v, sizeof(v));
+  }
+  return data;
+}
+
+// clap_plugin_state::save() of a plugin writing its state in pieces
+bool save(const clap_ostream_t* stream, const std::vector<uint8_t>& state)
+{
+  for (size_t i = 0; i < state.size(); i += pieceSize)
+  {
+    auto n = std::min(pieceSize, state.size() - i);
+    if (stream->write(stream, &state[i], n) != (int64_t)n) return false;
+  }
+  return true;
+}
+
+bool load(const clap_istream_t* stream, std::vector<uint8_t>& state)
+{
+  for (size_t i = 0; i < state.size(); i += pieceSize)
+  {
+    auto n = std::min(pieceSize, state.size() - i);
+    if (stream->read(stream, &state[i], n) != (int64_t)n) return false;
+  }
+  return true;
+}
+
+// the unbuffered adapter of earlier versions
+struct DirectStream
+{
+  Steinberg::IBStream* stream;
+  clap_istream_t in = {this, read};
+  clap_ostream_t out = {this, write};
+
+  static int64_t read(const clap_istream_t* s, void* buffer, uint64_t size)
+  {
+    auto self = static_cast<DirectStream*>(s->ctx);
+    Steinberg::int32 bytesRead = 0;
+    if (self->stream->read(buffer, (Steinberg::int32)size, &bytesRead) != Steinberg::kResultOk) return -1;
+    return bytesRead;
+  }
+  static int64_t write(const clap_ostream_t* s, const void* buffer, uint64_t size)
+  {
+    auto self = static_cast<DirectStream*>(s->ctx);
+    Steinberg::int32 bytesWritten = 0;
+    if (self->stream->write(const_cast<void*>(buffer), (Steinberg::int32)size, &bytesWritten) !=
+        Steinberg::kResultOk)
+    {
+      return -1;
+    }
+    return bytesWritten;
+  }
+};
+
+void rewind(Steinberg::MemoryStream& stream)
+{
+  stream.seek(0, Steinberg::IBStream::kIBSeekSet, nullptr);
+}
+
+void benchState(const char* name, const std::vector<uint8_t>& state, uint32_t repeats)
+{
+  Steinberg::MemoryStream stream;
+  std::vector<uint8_t> loaded(state.size());
+  bool ok = true;
+
+  auto directSave = bench::nsPerCall(repeats,
+                                     [&]()
+                                     {
+                                       rewind(stream);
+                                       DirectStream direct{&stream};
+                                       ok &= save(&direct.out, state);
+                                     });
+  auto directLoad = bench::nsPerCall(repeats,
+                                     [&]()
+                                     {
+                                       rewind(stream);
+                                       DirectStream direct{&stream};
+                                       ok &= load(&direct.in, loaded);
+                                     });
+  ok &= loaded == state;
+
+  auto bufferedSave = bench::nsPerCall(repeats,
+                                       [&]()
+                                       {
+                                         rewind(stream);
+                                         CLAPVST3StreamAdapter adapter(&stream);
+                                         ok &= save(adapter, state) && adapter.finishWriting();
+                                       });
+  auto bufferedLoad = bench::nsPerCall(repeats,
+                                       [&]()
+                                       {
+                                         rewind(stream);
+                                         CLAPVST3StreamAdapter adapter(&stream);
+                                         ok &= load(adapter, loaded);
+                                         adapter.finishReading();
+                                       });
+  ok &= loaded == state;
+
+  Steinberg::MemoryStream packed;
+  auto compressedSave = bench::nsPerCall(repeats,
+                                         [&]()
+                                         {
+                                           rewind(packed);
+                                           CLAPVST3StreamAdapter adapter(&packed, true);
+                                           ok &= save(adapter, state) && adapter.finishWriting();
+                                         });
+  Steinberg::int64 packedSize = 0;
+  packed.tell(&packedSize);
+  auto compressedLoad = bench::nsPerCall(repeats,
+                                         [&]()
+                                         {
+                                           rewind(packed);
+                                           CLAPVST3StreamAdapter adapter(&packed);
+                                           ok &= load(adapter, loaded);
+                                           adapter.finishReading();
+                                         });
+  ok &= loaded == state;
+
+  printf("%s, %zu bytes in pieces of %zu, %lld bytes compressed%s\n", name, state.size(), pieceSize,
+         (long long)packedSize, ok ? "" : " (FAILED)");
+  bench::report("save, direct", directSave, "save");
+  bench::report("save, buffered", bufferedSave, "save");
+  bench::report("save, compressed", compressedSave, "save");
+  bench::report("load, direct", directLoad, "load");
+  bench::report("load, buffered", bufferedLoad, "load");
+  bench::report("load, compressed", compressedLoad, "load");
+  if (!ok)
+  {
+    exit(1);
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  benchState("preset state", presetState(1 << 20), bench::repeats(argc, argv, 200));
+  benchState("sample state", sampleState(32 << 20), bench::repeats(argc, argv, 10));
+  return 0;
+}
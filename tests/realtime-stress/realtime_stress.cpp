@@ -0,0 +1,185 @@
+/*
+    realtime stress run
+
+    drives the building blocks the wrappers use on the audio thread (event arena and sorting,
+    active notes, the edit queue towards the main thread, the log ring and the thread pool)
+    for many blocks inside a realtime::Scope, with a consumer thread draining the edits at the
+    same time. Fails if the audit saw a single allocation or lock.
+
+    Afterwards it allocates and locks on purpose to make sure the audit is actually hooked in,
+    a run which counts nothing because nothing was hooked would prove nothing.
+*/
+
+#include "detail/shared/activenotes.h"
+#include "detail/shared/editqueue.h"
+#include "detail/shared/eventarena.h"
+#include "detail/shared/eventsort.h"
+#include "detail/shared/logring.h"
+#include "detail/shared/realtimeaudit.h"
+#include "detail/shared/threadpool.h"
+#include "detail/shared/threadrole.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace ClapWrapper::detail::shared;
+
+namespace
+{
+constexpr uint32_t numBlocks = 20000;
+constexpr uint32_t blockSize = 256;
+constexpr uint32_t numParams = 64;
+
+struct PoolContext
+{
+  std::atomic<uint32_t> sum{0};
+};
+
+void poolTask(void* context, uint32_t index)
+{
+  static_cast<PoolContext*>(context)->sum.fetch_add(index + 1, std::memory_order_relaxed);
+}
+
+clap_event_note_t makeNote(uint16_t type, uint32_t time, int16_t key)
+{
+  clap_event_note_t ev{};
+  ev.header = {sizeof(ev), time, CLAP_CORE_EVENT_SPACE_ID, type, 0};
+  ev.note_id = key;
+  ev.port_index = 0;
+  ev.channel = 0;
+  ev.key = key;
+  ev.velocity = 1.;
+  return ev;
+}
+
+clap_event_param_value_t makeParam(uint32_t time, clap_id id, double value)
+{
+  clap_event_param_value_t ev{};
+  ev.header = {sizeof(ev), time, CLAP_CORE_EVENT_SPACE_ID, CLAP_EVENT_PARAM_VALUE, 0};
+  ev.param_id = id;
+  ev.note_id = -1;
+  ev.port_index = -1;
+  ev.channel = -1;
+  ev.key = -1;
+  ev.value = value;
+  return ev;
+}
+}  // namespace
+
+int main()
+{
+  EventArena arena;
+  arena.reserve(1024, 1024 * sizeof(clap_event_param_value_t));
+  EventIndexSorter sorter;
+  sorter.reserve(1024 + 512);
+  ActiveNoteTable notes;
+  auto edits = std::make_unique<EditQueue<4096>>();
+  auto pool = ThreadPool::acquire();
+  PoolContext poolContext;
+
+  std::atomic<bool> running{true};
+  std::thread consumer(
+      [&]()
+      {
+        while (running.load())
+        {
+          edits->drain([](const auto&) {});
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      });
+
+  setThreadRole(ThreadRole::audio);
+  uint32_t delivered = 0;
+  {
+    realtime::Scope realtime;
+    for (uint32_t block = 0; block < numBlocks; ++block)
+    {
+      arena.clear();
+
+      // a few note ons and offs, then automation of every parameter on top, so the events
+      // arrive as several ascending runs like they do from the host's queues
+      for (int16_t k = 0; k < 8; ++k)
+      {
+        auto key = (int16_t)((block * 8 + k) % 128);
+        auto on = makeNote(CLAP_EVENT_NOTE_ON, (uint32_t)k * 16, key);
+        if (arena.push(&on.header))
+        {
+          notes.add(on.note_id, on.port_index, on.channel, on.key);
+        }
+        auto off = makeNote(CLAP_EVENT_NOTE_OFF, (uint32_t)k * 16 + 8, key);
+        arena.push(&off.header);
+        notes.remove(off.note_id, off.port_index, off.channel, off.key);
+      }
+      for (clap_id p = 0; p < numParams; ++p)
+      {
+        for (uint32_t t = 0; t < blockSize; t += 64)
+        {
+          auto ev = makeParam(t + p % 64, p, (double)(block % 100) / 100.);
+          arena.push(&ev.header);
+        }
+      }
+      sorter.sort(arena.order(), [&](uint32_t offset) { return arena.at(offset)->time; });
+      delivered += arena.size();
+
+      // a streamed gesture per block
+      auto id = block % numParams;
+      edits->begin(id);
+      for (uint32_t i = 0; i < 4; ++i)
+      {
+        edits->value(id, (double)i / 4.);
+      }
+      edits->end(id);
+
+      if (block % 64 == 0)
+      {
+        static const char message[] = "[clap-wrapper] realtime stress block";
+        log::post(log::Source::wrapper, CLAP_LOG_DEBUG, message, sizeof(message) - 1);
+      }
+
+      pool->run(poolTask, &poolContext, 8);
+    }
+  }
+  setThreadRole(ThreadRole::unknown);
+
+  running = false;
+  consumer.join();
+
+  const auto allocations = realtime::allocationCount();
+  const auto locks = realtime::lockCount();
+  printf("[clap-wrapper] realtime stress: %u blocks, %u events, %llu allocations, %llu locks\n",
+         numBlocks, delivered, (unsigned long long)allocations, (unsigned long long)locks);
+  if (allocations != 0 || locks != 0)
+  {
+    return 1;
+  }
+
+  if (std::getenv("CLAP_WRAPPER_AUDIT_ABORT"))
+  {
+    return 0;
+  }
+
+  // the audit has to see these
+  std::mutex lock;
+  {
+    realtime::Scope realtime;
+    std::vector<int> v(16);
+    std::lock_guard<std::mutex> guard(lock);
+  }
+  if (realtime::allocationCount() == allocations)
+  {
+    printf("[clap-wrapper] realtime stress: the audit didn't see an allocation, is it hooked in?\n");
+    return 1;
+  }
+  if (realtime::lockCount() == locks)
+  {
+    // locks are only visible with the preload library
+    printf("[clap-wrapper] realtime stress: locks are not audited in this run\n");
+  }
+  return 0;
+}
@@ -0,0 +1,101 @@
+/*
+    activenotes.h: random adds and removes against a std::map. The note ids are drawn from a
+    small range, so they collide in the id table a lot and the backward shift deletion has
+    to keep every remaining note reachable.
+*/
+
+#include "check.h"
+#include "detail/shared/activenotes.h"
+
+#include <map>
+#include <random>
+
+using namespace ClapWrapper::detail::shared;
+
+namespace
+{
+struct Note
+{
+  int16_t port, channel, key;
+};
+
+void checkModel(const ActiveNoteTable& table, const std::map<int32_t, Note>& model)
+{
+  CHECK(table.size() == model.size());
+  for (int32_t id = 0; id < 1024; ++id)
+  {
+    auto note = table.findByNoteId(id);
+    auto it = model.find(id);
+    if (it == model.end())
+    {
+      CHECK(note == nullptr);
+      continue;
+    }
+    CHECK(note != nullptr);
+    if (note)
+    {
+      CHECK(note->note_id == id && note->port_index == it->second.port &&
+            note->channel == it->second.channel && note->key == it->second.key);
+    }
+  }
+}
+}  // namespace
+
+int main()
+{
+  std::mt19937 random(7);
+  ActiveNoteTable table;
+  std::map<int32_t, Note> model;
+
+  for (int op = 0; op < 20000; ++op)
+  {
+    const int32_t id = (int32_t)(random() % 1024);
+    if (random() % 2 == 0 && model.size() < ActiveNoteTable::capacity)
+    {
+      Note n{(int16_t)(random() % 2), (int16_t)(random() % 16), (int16_t)(random() % 128)};
+      CHECK(table.add(id, n.port, n.channel, n.key));
+      model[id] = n;  // a reused id replaces the note
+    }
+    else if (!model.empty())
+    {
+      auto it = model.begin();
+      std::advance(it, random() % model.size());
+      table.remove(it->first, it->second.port, it->second.channel, it->second.key);
+      model.erase(it);
+    }
+    if (op % 97 == 0)
+    {
+      checkModel(table, model);
+    }
+  }
+  checkModel(table, model);
+
+  // notes without id are found by port/channel/key, the latest one first
+  table.clear();
+  CHECK(table.add(-1, 0, 3, 60));
+  CHECK(table.add(-1, 0, 3, 60));
+  CHECK(table.add(-1, 0, 3, 64));
+  CHECK(table.size() == 3);
+  CHECK(table.findByKey(0, 3, 60) != nullptr);
+  table.remove(-1, 0, 3, 60);
+  CHECK(table.findByKey(0, 3, 60) != nullptr);
+  table.remove(-1, 0, 3, -1);  // all notes without id on the channel
+  CHECK(table.size() == 0);
+  CHECK(table.findByKey(0, 3, 64) == nullptr);
+
+  // a note which can't be found again isn't added
+  CHECK(!table.add(-1, ActiveNoteTable::indexedPorts, 0, 60));
+
+  // a full table counts instead of growing
+  table.clear();
+  for (int32_t id = 0; id < ActiveNoteTable::capacity; ++id)
+  {
+    CHECK(table.add(id, 0, 0, (int16_t)(id % 128)));
+  }
+  const auto before = table.overflows();
+  CHECK(!table.add(ActiveNoteTable::capacity, 0, 0, 1));
+  CHECK(table.overflows() == before + 1);
+  CHECK(table.size() == ActiveNoteTable::capacity);
+
+  return CHECK_RESULT();
+}
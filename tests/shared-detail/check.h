@@ -0,0 +1,27 @@
+#pragma once
+
+/*
+    checks for the unit tests of the shared helpers
+
+    every test is its own executable, CHECK() prints the failed condition and the test returns
+    CHECK_RESULT() from main(), which makes ctest report it as failed.
+*/
+
+#include <cstdio>
+
+namespace check
+{
+inline int failures = 0;
+}
+
+#define CHECK(condition)                                                       \
+  do                                                                           \
+  {                                                                            \
+    if (!(condition))                                                          \
+    {                                                                          \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);     \
+      ++check::failures;                                                       \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_RESULT() (check::failures == 0 ? 0 : 1)
@@ -0,0 +1,40 @@
+/*
+    constantbuffer.h: a buffer is constant if every sample equals the first one, a single
+    different sample anywhere (in the vector part or the tail) makes it non constant
+*/
+
+#include "check.h"
+#include "detail/shared/constantbuffer.h"
+
+#include <vector>
+
+using namespace ClapWrapper::detail::shared;
+
+template <typename T>
+void checkBuffers()
+{
+  for (uint32_t n = 0; n < 40; ++n)
+  {
+    std::vector<T> buffer(n, (T)0.25);
+    CHECK(isConstantBuffer(buffer.data(), n));
+
+    for (uint32_t i = 0; i < n; ++i)
+    {
+      buffer[i] = (T)0.5;
+      CHECK(n == 1 || !isConstantBuffer(buffer.data(), n));
+      buffer[i] = (T)0.25;
+    }
+  }
+
+  // silence may come with either sign
+  std::vector<T> zeros(64, (T)0.);
+  zeros[17] = (T)-0.;
+  CHECK(isConstantBuffer(zeros.data(), 64));
+}
+
+int main()
+{
+  checkBuffers<float>();
+  checkBuffers<double>();
+  return CHECK_RESULT();
+}
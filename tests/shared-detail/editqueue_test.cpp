@@ -0,0 +1,164 @@
+/*
+    editqueue.h: values coalesce between drains but never across a begin or end of the same
+    parameter, a full queue still takes values it can merge, and with a consumer draining
+    concurrently every parameter sees well formed gestures with the last value of each
+*/
+
+#include "check.h"
+#include "detail/shared/editqueue.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace ClapWrapper::detail::shared;
+
+namespace
+{
+template <typename Queue>
+std::vector<typename Queue::Edit> drainAll(Queue& queue)
+{
+  std::vector<typename Queue::Edit> edits;
+  queue.drain([&](const auto& e) { edits.push_back(e); });
+  return edits;
+}
+}  // namespace
+
+int main()
+{
+  using Queue = EditQueue<16, 64>;
+  using Type = Queue::Edit::Type;
+
+  {
+    // a streamed gesture ends up as begin, last value, end
+    Queue q;
+    CHECK(q.begin(1));
+    for (int i = 1; i <= 10; ++i) CHECK(q.value(1, i * 0.1));
+    CHECK(q.end(1));
+    auto edits = drainAll(q);
+    CHECK(edits.size() == 3);
+    CHECK(edits[0].type == Type::begin && edits[0].id == 1);
+    CHECK(edits[1].type == Type::value && edits[1].value == 10 * 0.1);
+    CHECK(edits[2].type == Type::end);
+    CHECK(q.coalesced() == 9);
+  }
+
+  {
+    // values around a boundary keep their side of it
+    Queue q;
+    CHECK(q.value(2, 0.25));
+    CHECK(q.begin(2));
+    CHECK(q.value(2, 0.5));
+    CHECK(q.end(2));
+    CHECK(q.value(2, 0.75));
+    CHECK(q.value(2, 1.0));
+    auto edits = drainAll(q);
+    // both cells are still queued after the end, so the last values are passed by value
+    CHECK(edits.size() == 6);
+    CHECK(edits[0].type == Type::value && edits[0].value == 0.25);
+    CHECK(edits[1].type == Type::begin);
+    CHECK(edits[2].type == Type::value && edits[2].value == 0.5);
+    CHECK(edits[3].type == Type::end);
+    CHECK(edits[4].type == Type::value && edits[4].value == 0.75);
+    CHECK(edits[5].type == Type::value && edits[5].value == 1.0);
+
+    // once drained, the values coalesce again
+    CHECK(q.value(2, 0.1));
+    CHECK(q.value(2, 0.2));
+    edits = drainAll(q);
+    CHECK(edits.size() == 1 && edits[0].value == 0.2);
+  }
+
+  {
+    // a full queue drops new markers but still merges into queued values
+    Queue q;
+    for (uint32_t id = 0; id < 15; ++id) CHECK(q.value(id, 0.));
+    CHECK(!q.value(15, 1.));
+    CHECK(!q.begin(3));
+    CHECK(q.overflows() == 2);
+    CHECK(q.value(3, 0.5));
+    CHECK(q.overflows() == 2);
+    auto edits = drainAll(q);
+    CHECK(edits.size() == 15);
+    CHECK(edits[3].id == 3 && edits[3].value == 0.5);
+    // the dropped value left no cell behind which is marked queued
+    CHECK(q.value(15, 1.));
+    edits = drainAll(q);
+    CHECK(edits.size() == 1 && edits[0].id == 15 && edits[0].value == 1.);
+  }
+
+  {
+    // a producer streaming gestures of several parameters while the consumer drains them
+    constexpr uint32_t numParams = 8;
+    constexpr uint32_t numGestures = 2000;
+    using StreamQueue = EditQueue<256, 64>;
+    using StreamType = StreamQueue::Edit::Type;
+    auto q = std::make_unique<StreamQueue>();
+    std::atomic<bool> done{false};
+
+    std::thread producer(
+        [&]()
+        {
+          for (uint32_t g = 0; g < numGestures; ++g)
+          {
+            for (uint32_t id = 0; id < numParams; ++id)
+            {
+              while (!q->begin(id)) std::this_thread::yield();
+              for (uint32_t i = 0; i < 16; ++i)
+              {
+                // the value tells the gesture it belongs to
+                while (!q->value(id, g * 100. + i)) std::this_thread::yield();
+              }
+              while (!q->end(id)) std::this_thread::yield();
+            }
+          }
+          done = true;
+        });
+
+    struct State
+    {
+      bool open = false;
+      uint32_t gestures = 0;
+      double last = -1.;
+    };
+    std::vector<State> states(numParams);
+    auto consume = [&](const StreamQueue::Edit& e)
+    {
+      auto& s = states[e.id];
+      switch (e.type)
+      {
+        case StreamType::begin:
+          CHECK(!s.open);
+          s.open = true;
+          s.last = -1.;
+          break;
+        case StreamType::value:
+          CHECK(s.open);
+          CHECK((uint32_t)(e.value / 100.) == s.gestures);
+          CHECK(e.value > s.last);
+          s.last = e.value;
+          break;
+        case StreamType::end:
+          CHECK(s.open);
+          CHECK(s.last == s.gestures * 100. + 15);
+          s.open = false;
+          ++s.gestures;
+          break;
+      }
+    };
+    while (!done.load())
+    {
+      q->drain(consume);
+    }
+    producer.join();
+    q->drain(consume);
+
+    for (auto& s : states)
+    {
+      CHECK(!s.open && s.gestures == numGestures);
+    }
+  }
+
+  return CHECK_RESULT();
+}
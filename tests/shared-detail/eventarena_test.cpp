@@ -0,0 +1,117 @@
+/*
+    eventarena.h: events are copied packed and come back in push order, a full arena counts
+    overflows instead of growing, and note offs still fit after everything else ran full
+*/
+
+#include "check.h"
+#include "detail/shared/eventarena.h"
+
+#include <cstring>
+#include <utility>
+
+using namespace ClapWrapper::detail::shared;
+
+namespace
+{
+clap_event_note_t note(uint16_t type, uint32_t time, int16_t key)
+{
+  clap_event_note_t ev{};
+  ev.header = {sizeof(ev), time, CLAP_CORE_EVENT_SPACE_ID, type, 0};
+  ev.note_id = -1;
+  ev.key = key;
+  return ev;
+}
+
+clap_event_param_value_t param(uint32_t time, clap_id id)
+{
+  clap_event_param_value_t ev{};
+  ev.header = {sizeof(ev), time, CLAP_CORE_EVENT_SPACE_ID, CLAP_EVENT_PARAM_VALUE, 0};
+  ev.param_id = id;
+  ev.value = id * 0.5;
+  return ev;
+}
+
+clap_event_midi_t midi(uint8_t status, uint8_t key, uint8_t velocity)
+{
+  clap_event_midi_t ev{};
+  ev.header = {sizeof(ev), 0, CLAP_CORE_EVENT_SPACE_ID, CLAP_EVENT_MIDI, 0};
+  ev.data[0] = status;
+  ev.data[1] = key;
+  ev.data[2] = velocity;
+  return ev;
+}
+}  // namespace
+
+int main()
+{
+  constexpr size_t numEvents = 64;
+  EventArena arena;
+  arena.reserve(numEvents, numEvents * sizeof(clap_event_param_value_t));
+
+  // mixed sizes come back unchanged and in order
+  auto on = note(CLAP_EVENT_NOTE_ON, 0, 60);
+  auto p = param(3, 17);
+  auto m = midi(0xB0, 1, 64);
+  CHECK(arena.push(&on.header) != nullptr);
+  CHECK(arena.push(&p.header) != nullptr);
+  CHECK(arena.push(&m.header) != nullptr);
+  CHECK(arena.size() == 3);
+  CHECK(memcmp(arena.get(0), &on, sizeof(on)) == 0);
+  CHECK(memcmp(arena.get(1), &p, sizeof(p)) == 0);
+  CHECK(memcmp(arena.get(2), &m, sizeof(m)) == 0);
+  CHECK(arena.get(3) == nullptr);
+
+  // reordering only touches the offsets
+  std::swap(arena.order()[0], arena.order()[2]);
+  CHECK(arena.get(0)->type == CLAP_EVENT_MIDI);
+  CHECK(arena.get(2)->type == CLAP_EVENT_NOTE_ON);
+
+  arena.clear();
+  CHECK(arena.empty());
+
+  // fill it with automation until it is full
+  uint32_t pushed = 0;
+  while (arena.remaining(sizeof(clap_event_param_value_t)) > 0)
+  {
+    auto ev = param(pushed, pushed);
+    CHECK(arena.push(&ev.header) != nullptr);
+    ++pushed;
+  }
+  CHECK(pushed == numEvents);
+  auto ev = param(0, 0);
+  CHECK(arena.push(&ev.header) == nullptr);
+  CHECK(arena.overflows() == 1);
+  auto late = note(CLAP_EVENT_NOTE_ON, 5, 61);
+  CHECK(arena.push(&late.header) == nullptr);
+  CHECK(arena.overflows() == 2);
+
+  // the events ending notes still get through
+  auto off = note(CLAP_EVENT_NOTE_OFF, 7, 60);
+  auto choke = note(CLAP_EVENT_NOTE_CHOKE, 7, 62);
+  auto midiOff = midi(0x80, 60, 0);
+  auto midiOnZero = midi(0x90, 62, 0);
+  CHECK(arena.push(&off.header) != nullptr);
+  CHECK(arena.push(&choke.header) != nullptr);
+  CHECK(arena.push(&midiOff.header) != nullptr);
+  CHECK(arena.push(&midiOnZero.header) != nullptr);
+  auto midiOn = midi(0x90, 62, 100);
+  CHECK(arena.push(&midiOn.header) == nullptr);
+  CHECK(arena.overflows() == 3);
+  CHECK(arena.size() == numEvents + 4);
+
+  // until the headroom is used up as well
+  uint32_t offs = 0;
+  while (arena.push(&off.header))
+  {
+    ++offs;
+  }
+  CHECK(offs > 0);
+  CHECK(arena.overflows() == 4);
+
+  // the overflow count is kept over clear()
+  arena.clear();
+  CHECK(arena.push(&p.header) != nullptr);
+  CHECK(arena.overflows() == 4);
+
+  return CHECK_RESULT();
+}
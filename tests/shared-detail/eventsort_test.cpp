@@ -0,0 +1,96 @@
+/*
+    eventsort.h: merging the ascending runs has to give the same order as a stable sort by
+    time, for any number of runs and with many equal times
+*/
+
+#include "check.h"
+#include "detail/shared/eventsort.h"
+#include "detail/shared/eventarena.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace ClapWrapper::detail::shared;
+
+int main()
+{
+  EventIndexSorter sorter;
+  sorter.reserve(1024);
+  std::mt19937 random(42);
+
+  for (int round = 0; round < 500; ++round)
+  {
+    // the events of a block: a few sources, each ordered by time, appended one after the other
+    std::vector<uint32_t> times;
+    const auto numRuns = 1 + random() % 12;
+    for (uint32_t r = 0; r < numRuns; ++r)
+    {
+      const auto length = random() % 40;
+      uint32_t time = random() % 8;
+      for (uint32_t i = 0; i < length; ++i)
+      {
+        time += random() % 3;  // plenty of equal times
+        times.push_back(time);
+      }
+    }
+
+    std::vector<uint32_t> indices(times.size());
+    for (uint32_t i = 0; i < indices.size(); ++i) indices[i] = i;
+    auto expected = indices;
+    std::stable_sort(expected.begin(), expected.end(),
+                     [&](uint32_t a, uint32_t b) { return times[a] < times[b]; });
+
+    sorter.sort(indices, [&](uint32_t index) { return times[index]; });
+    CHECK(indices == expected);
+  }
+
+  // sorted input is left alone
+  std::vector<uint32_t> sorted = {0, 1, 2, 3};
+  std::vector<uint32_t> sortedTimes = {0, 0, 5, 9};
+  sorter.sort(sorted, [&](uint32_t index) { return sortedTimes[index]; });
+  CHECK((sorted == std::vector<uint32_t>{0, 1, 2, 3}));
+
+  // ties between runs keep the earlier run first
+  std::vector<uint32_t> tied = {0, 1, 2, 3};
+  std::vector<uint32_t> tiedTimes = {4, 8, 4, 8};
+  sorter.sort(tied, [&](uint32_t index) { return tiedTimes[index]; });
+  CHECK((tied == std::vector<uint32_t>{0, 2, 1, 3}));
+
+  {
+    // an arena flooded up to its headroom, in descending times (one run per event), sorts
+    // without growing the sorter
+    EventArena arena;
+    arena.reserve(256, 256 * sizeof(clap_event_param_value_t));
+    EventIndexSorter arenaSorter;
+    arenaSorter.reserve(arena.capacity());
+    const auto capacity = arenaSorter.capacity();
+
+    uint32_t time = 100000;
+    clap_event_param_value_t p{};
+    p.header = {sizeof(p), 0, CLAP_CORE_EVENT_SPACE_ID, CLAP_EVENT_PARAM_VALUE, 0};
+    do
+    {
+      p.header.time = time--;
+    } while (arena.push(&p.header));
+    clap_event_note_t off{};
+    off.header = {sizeof(off), 0, CLAP_CORE_EVENT_SPACE_ID, CLAP_EVENT_NOTE_OFF, 0};
+    do
+    {
+      off.header.time = time--;
+    } while (arena.push(&off.header));
+    CHECK(arena.size() == arena.capacity());
+    CHECK(arena.size() > 256);
+
+    arenaSorter.sort(arena.order(), [&](uint32_t offset) { return arena.at(offset)->time; });
+    CHECK(arenaSorter.capacity() == capacity);
+    bool ordered = true;
+    for (uint32_t i = 1; i < arena.size(); ++i)
+    {
+      ordered = ordered && arena.get(i - 1)->time <= arena.get(i)->time;
+    }
+    CHECK(ordered);
+  }
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,40 @@
+/*
+    logring.h: messages above the rate limit of the writer are dropped and counted, errors
+    are always printed
+*/
+
+#include "check.h"
+#include "detail/shared/logring.h"
+
+#include <cstring>
+
+using namespace ClapWrapper::detail::shared;
+
+int main()
+{
+  // without a writer every post() on this thread prints the ring, far above the rate limit
+  const char* text = "[clap-wrapper] logring test";
+  const auto before = log::droppedCount();
+  for (int i = 0; i < 400; ++i)
+  {
+    log::post(log::Source::wrapper, CLAP_LOG_ERROR, text, strlen(text));
+  }
+  CHECK(log::droppedCount() == before);
+
+  for (int i = 0; i < 400; ++i)
+  {
+    log::post(log::Source::wrapper, CLAP_LOG_DEBUG, text, strlen(text));
+  }
+  CHECK(log::droppedCount() > before);
+
+  // filtered messages are neither printed nor counted
+  log::setMinSeverity(CLAP_LOG_WARNING);
+  const auto filtered = log::droppedCount();
+  log::post(log::Source::wrapper, CLAP_LOG_DEBUG, text, strlen(text));
+  CHECK(log::droppedCount() == filtered);
+  CHECK(!log::accepts(CLAP_LOG_INFO));
+  CHECK(log::accepts(CLAP_LOG_ERROR));
+
+  log::flush();
+  return CHECK_RESULT();
+}
@@ -0,0 +1,171 @@
+/*
+    lzblock.h: blocks have to decode to exactly what was compressed, for any size and kind of
+    data, compress() has to report an output which doesn't fit and decompress() has to reject
+    truncated or corrupted blocks without reading or writing out of bounds (run it with the
+    address sanitizer to see the latter)
+*/
+
+#include "check.h"
+#include "detail/shared/lzblock.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ClapWrapper::detail::shared;
+
+namespace
+{
+std::mt19937 rng(42);
+
+std::vector<uint8_t> randomBytes(size_t size)
+{
+  std::vector<uint8_t> data(size);
+  for (auto& b : data) b = (uint8_t)rng();
+  return data;
+}
+
+std::vector<uint8_t> text(size_t size)
+{
+  static const std::string words[] = {"<param ", "id=\"", "value=\"", "0.5", "\"/>\n", "osc", "filter"};
+  std::vector<uint8_t> data;
+  while (data.size() < size)
+  {
+    const auto& w = words[rng() % 7];
+    data.insert(data.end(), w.begin(), w.end());
+  }
+  data.resize(size);
+  return data;
+}
+
+// zeroed tables with a few values and random stretches in between
+std::vector<uint8_t> mixed(size_t size)
+{
+  std::vector<uint8_t> data(size, 0);
+  for (size_t i = 0; i < size; i += 1 + rng() % 500)
+  {
+    auto n = std::min<size_t>(rng() % 300, size - i);
+    for (size_t k = 0; k < n; ++k) data[i + k] = (uint8_t)rng();
+  }
+  return data;
+}
+
+std::vector<uint8_t> compress(LzBlockEncoder& encoder, const std::vector<uint8_t>& data)
+{
+  std::vector<uint8_t> block(LzBlockEncoder::bound(data.size()));
+  auto n = encoder.compress(data.data(), data.size(), block.data(), block.size());
+  CHECK(n > 0);
+  block.resize(n);
+  return block;
+}
+
+// decodes into a buffer of exactly size bytes, so the sanitizer sees every overrun
+bool decompress(const std::vector<uint8_t>& block, size_t size, std::vector<uint8_t>* out = nullptr)
+{
+  std::vector<uint8_t> in(block);
+  std::vector<uint8_t> dst(size);
+  auto ok = lzBlockDecompress(in.data(), in.size(), dst.data(), dst.size());
+  if (out) *out = std::move(dst);
+  return ok;
+}
+
+void roundTrip(LzBlockEncoder& encoder, const std::vector<uint8_t>& data)
+{
+  auto block = compress(encoder, data);
+  CHECK(block.size() <= LzBlockEncoder::bound(data.size()));
+
+  std::vector<uint8_t> decoded;
+  CHECK(decompress(block, data.size(), &decoded));
+  CHECK(decoded == data);
+
+  // the size has to be exact
+  CHECK(!decompress(block, data.size() + 1));
+  if (!data.empty())
+  {
+    CHECK(!decompress(block, data.size() - 1));
+  }
+
+  // an output one byte too small for the block is reported
+  if (!block.empty())
+  {
+    std::vector<uint8_t> small(block.size() - 1);
+    CHECK(encoder.compress(data.data(), data.size(), small.data(), small.size()) == 0);
+  }
+}
+}  // namespace
+
+int main()
+{
+  LzBlockEncoder encoder;
+
+  // around the smallest input which can have a match
+  for (size_t size = 0; size < 40; ++size)
+  {
+    roundTrip(encoder, std::vector<uint8_t>(size, 0));
+    roundTrip(encoder, randomBytes(size));
+    roundTrip(encoder, text(size));
+  }
+
+  // long literal runs and long matches need the extra length bytes, random data beyond
+  // 64k can't use far matches
+  for (size_t size : {270u, 4096u, 65535u, 65536u, 200000u})
+  {
+    roundTrip(encoder, std::vector<uint8_t>(size, 0));
+    roundTrip(encoder, randomBytes(size));
+    roundTrip(encoder, text(size));
+    roundTrip(encoder, mixed(size));
+  }
+
+  // compressible data has to get smaller
+  {
+    auto data = text(100000);
+    CHECK(compress(encoder, data).size() < data.size() / 2);
+    std::vector<uint8_t> zeros(100000, 0);
+    CHECK(compress(encoder, zeros).size() < 1000);
+  }
+
+  std::vector<uint8_t> none;
+  CHECK(encoder.compress(nullptr, 0, none.data(), 0) == 0);
+
+  // a match before the start of the output, an offset of 0 and a missing offset
+  CHECK(!decompress({0x04, 0x01, 0x00}, 8));
+  CHECK(!decompress({0x14, 'a', 0x00, 0x00, 0x00}, 5));
+  CHECK(!decompress({0x14, 'a', 0x01}, 5));
+  // more literals than the block or the output has
+  CHECK(!decompress({0x50, 'a', 'b'}, 5));
+  CHECK(!decompress({0x30, 'a', 'b', 'c'}, 2));
+  // endless length bytes
+  CHECK(!decompress({0xF0, 255, 255, 255}, 1000));
+  CHECK(!decompress({}, 1));
+
+  // every truncation of a block fails
+  {
+    auto data = mixed(5000);
+    auto block = compress(encoder, data);
+    for (size_t n = 0; n < block.size(); ++n)
+    {
+      CHECK(!decompress(std::vector<uint8_t>(block.begin(), block.begin() + n), data.size()));
+    }
+  }
+
+  // corrupted blocks may decode to anything but have to stay in their buffers
+  {
+    auto data = text(3000);
+    auto block = compress(encoder, data);
+    for (size_t i = 0; i < block.size(); ++i)
+    {
+      for (int bit = 0; bit < 8; ++bit)
+      {
+        auto corrupt = block;
+        corrupt[i] ^= (uint8_t)(1 << bit);
+        decompress(corrupt, data.size());
+      }
+    }
+    for (int round = 0; round < 2000; ++round)
+    {
+      decompress(randomBytes(rng() % 200), rng() % 2000);
+    }
+  }
+
+  return CHECK_RESULT();
+}
@@ -0,0 +1,40 @@
+/*
+    sampleconvert.h: the vectorized loops and the scalar tail have to give the same result as
+    a plain cast for every length
+*/
+
+#include "check.h"
+#include "detail/shared/sampleconvert.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace ClapWrapper::detail::shared;
+
+int main()
+{
+  for (uint32_t n = 0; n < 38; ++n)
+  {
+    std::vector<double> d(n + 1), back(n + 1, -1.);
+    std::vector<float> f(n + 1, -1.f);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+      d[i] = std::sin(0.37 * i) * (i % 3 == 0 ? 1e-3 : 1.);
+    }
+
+    convertSamples(d.data(), f.data(), n);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+      CHECK(f[i] == static_cast<float>(d[i]));
+    }
+    CHECK(f[n] == -1.f);  // nothing written past the end
+
+    convertSamples(f.data(), back.data(), n);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+      CHECK(back[i] == static_cast<double>(f[i]));
+    }
+    CHECK(back[n] == -1.);
+  }
+  return CHECK_RESULT();
+}
@@ -0,0 +1,51 @@
+/*
+    threadrole.h: an untagged thread entering the audio entry points stays an audio thread,
+    the main thread only pretends to be one for the call, scopes restore the previous role
+*/
+
+#include "check.h"
+#include "detail/shared/threadrole.h"
+
+#include <thread>
+
+using namespace ClapWrapper::detail::shared;
+
+int main()
+{
+  // the host's process thread
+  std::thread processThread(
+      []
+      {
+        CHECK(threadRole() == ThreadRole::unknown);
+        {
+          AudioThreadEntry entry;
+          CHECK(threadRole() == ThreadRole::audio);
+        }
+        CHECK(threadRole() == ThreadRole::audio);
+        {
+          AudioThreadEntry entry;
+          CHECK(threadRole() == ThreadRole::audio);
+        }
+        CHECK(threadRole() == ThreadRole::audio);
+      });
+  processThread.join();
+
+  // the tag of the other thread isn't visible here
+  CHECK(threadRole() == ThreadRole::unknown);
+
+  // the main thread rendering offline
+  setThreadRole(ThreadRole::main);
+  {
+    AudioThreadEntry entry;
+    CHECK(threadRole() == ThreadRole::audio);
+  }
+  CHECK(threadRole() == ThreadRole::main);
+
+  {
+    ThreadRoleScope scope(ThreadRole::audio);
+    CHECK(threadRole() == ThreadRole::audio);
+  }
+  CHECK(threadRole() == ThreadRole::main);
+
+  return CHECK_RESULT();
+}
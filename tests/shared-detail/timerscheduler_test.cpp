@@ -0,0 +1,93 @@
+/*
+    timerscheduler.h: timers fire at their period, report the next deadline and the shortest
+    period, don't burst after a stall and can be removed or re-added, also from inside their
+    own callback
+*/
+
+#include "check.h"
+#include "detail/shared/timerscheduler.h"
+
+#include <map>
+#include <vector>
+
+using namespace ClapWrapper::detail::shared;
+
+int main()
+{
+  {
+    TimerScheduler s;
+    CHECK(s.nextDeadline() == TimerScheduler::never);
+    CHECK(s.shortestPeriod() == 0);
+
+    s.add(1, 10, 0);
+    s.add(2, 25, 0);
+    CHECK(s.nextDeadline() == 10);
+    CHECK(s.shortestPeriod() == 10);
+
+    // one millisecond at a time for 100 ms
+    std::map<uint32_t, int> fired;
+    for (uint64_t now = 1; now <= 100; ++now)
+    {
+      s.run(now, [&](uint32_t id) { ++fired[id]; });
+    }
+    CHECK(fired[1] == 10);
+    CHECK(fired[2] == 4);
+    CHECK(s.nextDeadline() == 110);
+
+    // a stall of a second fires every timer once, the next deadline is relative to now
+    fired.clear();
+    s.run(1100, [&](uint32_t id) { ++fired[id]; });
+    CHECK(fired[1] == 1 && fired[2] == 1);
+    CHECK(s.nextDeadline() == 1110);
+
+    // a removed timer doesn't fire and doesn't hold up the next deadline
+    s.remove(1);
+    CHECK(s.nextDeadline() == 1125);
+    CHECK(s.shortestPeriod() == 25);
+    fired.clear();
+    s.run(1200, [&](uint32_t id) { ++fired[id]; });
+    CHECK(fired.count(1) == 0 && fired[2] == 1);
+
+    s.remove(2);
+    CHECK(s.nextDeadline() == TimerScheduler::never);
+    CHECK(s.shortestPeriod() == 0);
+  }
+
+  {
+    // re-adding an id replaces the old schedule, the stale entry is skipped
+    TimerScheduler s;
+    s.add(7, 10, 0);
+    s.add(7, 50, 5);
+    CHECK(s.nextDeadline() == 55);
+    int fired = 0;
+    s.run(54, [&](uint32_t) { ++fired; });
+    CHECK(fired == 0);
+    s.run(55, [&](uint32_t) { ++fired; });
+    CHECK(fired == 1);
+  }
+
+  {
+    // callbacks which remove themselves or add other timers
+    TimerScheduler s;
+    s.add(1, 10, 0);
+    s.add(2, 10, 0);
+    std::vector<uint32_t> order;
+    s.run(10,
+          [&](uint32_t id)
+          {
+            order.push_back(id);
+            if (id == 1)
+            {
+              s.remove(1);
+              s.add(3, 5, 10);
+            }
+          });
+    CHECK(order.size() == 2);
+    CHECK(s.nextDeadline() == 15);
+    order.clear();
+    s.run(20, [&](uint32_t id) { order.push_back(id); });
+    CHECK((order == std::vector<uint32_t>{3, 2}));
+  }
+
+  return CHECK_RESULT();
+}